@@ -1,5 +1,6 @@
 #ifndef FONTS_H
 #define FONTS_H
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -7,6 +8,36 @@ extern "C"
 {
 #endif /* __cplusplus */
 
+// Decoded glyph cache for compressed fonts: number of glyphs kept and the
+// largest decoded glyph, in bytes ((width + 7) / 8 * height)
+#ifndef SH1106_GLYPH_CACHE_SLOTS
+#define SH1106_GLYPH_CACHE_SLOTS 8
+#endif
+#ifndef SH1106_GLYPH_CACHE_BYTES
+#define SH1106_GLYPH_CACHE_BYTES 64
+#endif
+
+// String width cache slots for font_measure(), 0 to disable, and the
+// longest string a slot keeps; longer strings are measured every time
+#ifndef SH1106_WIDTH_CACHE_SLOTS
+#define SH1106_WIDTH_CACHE_SLOTS 16
+#endif
+#ifndef SH1106_WIDTH_CACHE_LEN
+#define SH1106_WIDTH_CACHE_LEN 24
+#endif
+
+// Font registry size, built-in fonts included
+#ifndef SH1106_MAX_FONTS
+#define SH1106_MAX_FONTS 8
+#endif
+
+  typedef enum
+  {
+    FONT_ENCODING_RAW = 0,      // rows padded to whole bytes, MSB first
+    FONT_ENCODING_PACKED,       // glyph pixels as one bit string, no row padding
+    FONT_ENCODING_RLE,          // alternating off/on pixel run lengths in nibbles
+  } font_encoding_t;
+
   typedef struct _font_char_desc
   {
     uint8_t width;              // Character width in pixels
@@ -14,20 +45,89 @@ extern "C"
   } font_char_desc_t;
 
 
+  typedef struct _font_range
+  {
+    uint32_t first;             // First code point
+    uint16_t count;             // Code points in the range
+    uint16_t glyph;             // Descriptor of the first code point
+  } font_range_t;
+
   typedef struct _font_info
   {
     uint8_t height;             // Character height in pixels
     uint8_t c;                  // Space between adjacent characters
-    char char_start;            // First character
-    char char_end;              // Last character
-    const font_char_desc_t *char_descriptors;   // descriptor for each character
+    uint16_t char_start;        // First character, without ranges
+    uint16_t char_end;          // Last character, without ranges
+    const font_char_desc_t *char_descriptors;   // descriptor for each character, or NULL with widths/offsets
     const uint8_t *bitmap;      // Character bitmap
+    uint8_t encoding;           // font_encoding_t of the bitmap, raw if omitted
+    const font_range_t *ranges; // Code point ranges sorted by first, or NULL for char_start..char_end
+    uint16_t num_ranges;
+    const uint8_t *widths;      // Glyph widths, dense; replaces char_descriptors when set
+    const uint16_t *offsets;    // Glyph bitmap offsets, with widths
   } font_info_t;
 
+  static inline uint8_t font_glyph_width (const font_info_t *font, uint16_t glyph)
+  {
+    return (font->widths != NULL) ? font->widths[glyph] : font->char_descriptors[glyph].width;
+  }
+
+  static inline uint16_t font_glyph_offset (const font_info_t *font, uint16_t glyph)
+  {
+    return (font->widths != NULL) ? font->offsets[glyph] : font->char_descriptors[glyph].offset;
+  }
+
+  // Built-in font IDs
+#define FONT_GLCD_5X7 0
+#define FONT_TAHOMA_8PT 1
+
+  // Add a font to the registry; returns its ID (the existing one if it is
+  // already registered) or -1 if the registry is full or the font is
+  // compressed and a decoded glyph exceeds SH1106_GLYPH_CACHE_BYTES
+  int font_register (const font_info_t *font);
+
+  // Remove a font from the registry; its ID may be reused
+  void font_unregister (uint8_t id);
+
+  // Registered font, or NULL
+  const font_info_t *font_get (uint8_t id);
+
+  // Descriptor index of code point cp, or -1 if the font has no glyph for it
+  int32_t font_find_glyph (const font_info_t *font, uint32_t cp);
+
+  // Like font_find_glyph, but missing code points fall back to '?', then ' '
+  int32_t font_lookup_glyph (const font_info_t *font, uint32_t cp);
+
+  // Width in pixels of at most len bytes of a UTF-8 string, stopping at a
+  // NUL. Short strings are cached by content, so labels measured every
+  // frame cost one pass over their bytes.
+  uint16_t font_measure (const font_info_t *font, const char *str, size_t len);
+
+  // Decode the next code point of a UTF-8 string and advance past it. Bytes
+  // that do not form a valid sequence are taken as Latin-1 characters.
+  uint32_t font_utf8_next (const char **str);
+
+  // Same, for a buffer ending at end (NULL for a NUL-terminated string)
+  uint32_t font_utf8_next_n (const char **str, const char *end);
+
+  // The next character to draw with font: the next code point, or the lead
+  // byte alone when a multi-byte sequence decodes to a code point the font
+  // has no glyph for but the byte itself has one
+  uint32_t font_next_char (const font_info_t *font, const char **str, const char *end);
+
+  // Bitmap of glyph index in raw encoding; compressed glyphs are decoded into
+  // a direct-mapped cache and stay valid until a glyph with another index
+  // but the same index % SH1106_GLYPH_CACHE_SLOTS is fetched (or the font is
+  // forgotten). NULL if the decoded glyph is larger than
+  // SH1106_GLYPH_CACHE_BYTES.
+  const uint8_t *font_get_glyph (const font_info_t *font, uint16_t index);
 
-#define NUM_FONTS 2             // Number of built-in fonts
+  // Bytes taken by an RLE glyph of pixels pixels, or 0 if its runs don't end
+  // within avail bytes
+  uint32_t font_rle_size (const uint8_t *src, uint32_t avail, uint32_t pixels);
 
-  extern const font_info_t *fonts[NUM_FONTS];   // Built-in fonts
+  // Drop cached glyphs and widths of a font whose storage is going away
+  void font_forget (const font_info_t *font);
 
 #ifdef __cplusplus
 }
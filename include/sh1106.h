@@ -4,10 +4,13 @@
 #include "mgos_features.h"
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "mgos_init.h"
 #include "mgos_sys_config.h"
 
+#include "fonts.h"
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -21,6 +24,8 @@ extern "C"
 // Address for 128x32 is 0x3C
 // Address for 128x64 is 0x3D (default) or 0x3C (if SA0 is grounded)
 
+// Panel geometry used by SH1106_FIXED_GEOMETRY builds; otherwise the
+// controller init profile is picked at runtime from sh1106.width/height
 #define SH1106_128_64
 // #define SH1106_128_32
 // #define SH1106_96_16
@@ -63,12 +68,60 @@ extern "C"
 
 #define SH1106_SETMULTIPLEX 0xA8
 
-#define SH1106_SETLOWCOLUMN 0x02
+#define SH1106_SETLOWCOLUMN 0x00
 
 #define SH1106_SETHIGHCOLUMN 0x10
 
 #define SH1106_SETSTARTLINE 0x40
 
+#define SH1106_SETPAGEADDR 0xB0
+
+// Controller display RAM geometry
+#define SH1106_RAM_WIDTH 132
+#define SH1106_RAM_HEIGHT 64
+
+// Bytes needed for a page-format bitmap of the given size
+#define SH1106_BUFFER_SIZE(w, h) ((size_t) (w) * (((h) + 7) / 8))
+// Default canvas covers the whole controller RAM
+#define SH1106_CANVAS_BUFFER_SIZE SH1106_BUFFER_SIZE (SH1106_RAM_WIDTH, SH1106_RAM_HEIGHT)
+
+// Instance storage reserved by mgos_sh1106_storage_t, in 8-byte words
+#define SH1106_INSTANCE_WORDS 32
+
+// Specialize drawing for the geometry selected above: the panel size is taken
+// from SH1106_LCDWIDTH/SH1106_LCDHEIGHT and the canvas is fixed to the
+// controller RAM, so pixel addressing on it uses compile-time constants.
+// Off-screen surfaces keep the runtime path.
+#ifndef SH1106_FIXED_GEOMETRY
+#define SH1106_FIXED_GEOMETRY 0
+#endif
+
+// Build the global instance from static storage instead of the heap
+#ifndef SH1106_STATIC_ALLOC
+#define SH1106_STATIC_ALLOC 0
+#endif
+
+// Lines a text layout can hold, see mgos_sh1106_layout_text()
+#ifndef SH1106_TEXT_MAX_LINES
+#define SH1106_TEXT_MAX_LINES 16
+#endif
+
+// Priority regions for progressive refresh, see mgos_sh1106_set_priority()
+#ifndef SH1106_PRIORITY_REGIONS
+#define SH1106_PRIORITY_REGIONS 4
+#endif
+
+// Longest region name, terminator included, see mgos_sh1106_region_create()
+#ifndef SH1106_REGION_NAME_LEN
+#define SH1106_REGION_NAME_LEN 16
+#endif
+
+// Time changes from the first dirty mark to the end of the bus transfer that
+// sends them, see mgos_sh1106_get_latency(); the RPC needs rpc-common
+#ifndef SH1106_LATENCY_STATS
+#define SH1106_LATENCY_STATS 0
+#endif
+
 #define SH1106_MEMORYMODE 0x20
 #define SH1106_COLUMNADDR 0x21
 #define SH1106_PAGEADDR   0x22
@@ -99,8 +152,127 @@ extern "C"
     SH1106_COLOR_BLACK = 0,    //< Black (pixel off)
     SH1106_COLOR_WHITE = 1,    //< White (or blue, yellow, pixel on)
     SH1106_COLOR_INVERT = 2,   //< Invert pixel (XOR)
+    SH1106_COLOR_DARK_GRAY = 3,        //< Lit one subframe in three in gray mode, else black
+    SH1106_COLOR_LIGHT_GRAY = 4,       //< Lit two subframes in three in gray mode, else white
   } mgos_sh1106_color_t;
 
+  typedef enum
+  {
+    SH1106_ROP_COPY = 0,        //< Replace destination with source
+    SH1106_ROP_OR,              //< Set pixels set in source
+    SH1106_ROP_AND,             //< Clear pixels clear in source
+    SH1106_ROP_XOR,             //< Invert pixels set in source
+    SH1106_ROP_CLEAR,           //< Clear pixels set in source
+  } mgos_sh1106_rop_t;
+
+  typedef enum
+  {
+    SH1106_DITHER_BAYER = 0,    //< Ordered 8x8 Bayer matrix, stable under partial redraws
+    SH1106_DITHER_FLOYD_STEINBERG,      //< Error diffusion, smoother gradients
+  } mgos_sh1106_dither_t;
+
+  typedef enum
+  {
+    SH1106_IMAGE_PBM = 0,       //< Netpbm bitmap, plain (P1) or raw (P4)
+    SH1106_IMAGE_XBM,           //< X bitmap C source
+    SH1106_IMAGE_BMP,           //< Uncompressed 1 bit per pixel Windows bitmap
+  } mgos_sh1106_image_format_t;
+
+  typedef enum
+  {
+    SH1106_TEXT_LEFT = 0x00,    //< Align lines to the left edge of the box
+    SH1106_TEXT_CENTER = 0x01,  //< Center lines horizontally
+    SH1106_TEXT_RIGHT = 0x02,   //< Align lines to the right edge
+    SH1106_TEXT_TOP = 0x00,     //< Put the text at the top of the box
+    SH1106_TEXT_MIDDLE = 0x04,  //< Center the text vertically
+    SH1106_TEXT_BOTTOM = 0x08,  //< Put the text at the bottom of the box
+    SH1106_TEXT_WRAP = 0x10,    //< Wrap at spaces, or inside words wider than the box
+    SH1106_TEXT_ELLIPSIS = 0x20,        //< End clipped or truncated lines with an ellipsis
+  } mgos_sh1106_text_flags_t;
+
+  typedef enum
+  {
+    SH1106_NUMERIC_INT = 0,     //< Decimal integer
+    SH1106_NUMERIC_FIXED,       //< Fixed point: value in units of 10^-decimals
+    SH1106_NUMERIC_TIME,        //< Seconds as mm:ss, or h:mm:ss from one hour
+  } mgos_sh1106_numeric_format_t;
+
+  typedef enum
+  {
+    SH1106_ROTATE_0 = 0,        //< Panel orientation
+    SH1106_ROTATE_90,           //< Drawing turned 90 degrees clockwise on the panel
+    SH1106_ROTATE_180,          //< Upside down
+    SH1106_ROTATE_270,          //< Turned 90 degrees counterclockwise
+  } mgos_sh1106_rotation_t;
+
+  struct mgos_sh1106_surface;
+  struct mgos_sh1106_gray_stream;
+  struct mgos_sh1106_image_decoder;
+  struct mgos_sh1106_assets;
+  struct mgos_sh1106_numeric;
+  struct mgos_sh1106_chart;
+  struct mgos_sh1106_region;
+
+  /**
+   * Auto refresh counters, see `mgos_sh1106_get_auto_refresh_stats()`.
+   */
+  struct mgos_sh1106_refresh_stats
+  {
+    float fps;                  //< Frames flushed per second
+    float coalescing;           //< Refresh calls absorbed per frame
+    uint32_t frames;            //< Frames flushed
+    uint32_t requests;          //< Refresh calls absorbed
+  };
+
+  /**
+   * One laid out line: a byte range of the string it was laid out from.
+   */
+  struct mgos_sh1106_text_line
+  {
+    uint16_t start;             //< Offset of the first byte
+    uint16_t len;               //< Bytes drawn, excluding dropped spaces and clipped text
+    uint16_t width;             //< Width in pixels, ellipsis included
+    uint8_t ellipsis;           //< Line ends with an ellipsis
+  };
+
+  /**
+   * Line breaks and metrics of a text box, see `mgos_sh1106_layout_text()`.
+   */
+  struct mgos_sh1106_text_layout
+  {
+    uint16_t flags;             //< mgos_sh1106_text_flags_t the layout was made with
+    uint16_t line_height;       //< Font height plus spacing
+    uint16_t lines;             //< Lines laid out
+    uint16_t width;             //< Widest line
+    uint16_t height;            //< Height of all lines
+    uint16_t next;              //< Offset of the first byte not laid out
+    bool truncated;             //< Text was left over
+    struct mgos_sh1106_text_line line[SH1106_TEXT_MAX_LINES];
+  };
+
+  /**
+   * Draw-to-panel latency percentiles, see `mgos_sh1106_get_latency()`.
+   * Percentiles are upper bounds of histogram buckets, within 25%.
+   */
+  struct mgos_sh1106_latency_stats
+  {
+    uint32_t count;             //< Refreshes measured
+    uint32_t p50_us;            //< Median, in microseconds
+    uint32_t p95_us;
+    uint32_t p99_us;
+    uint32_t max_us;            //< Longest, exact
+  };
+
+  /**
+   * Caller-provided storage for a driver instance and its default canvas,
+   * see `mgos_sh1106_create_static()`.
+   */
+  typedef struct
+  {
+    uint64_t instance[SH1106_INSTANCE_WORDS];
+    uint8_t buffer[SH1106_CANVAS_BUFFER_SIZE];
+  } mgos_sh1106_storage_t;
+
   /**
    * @brief Standard Mongoose-OS init hook.
    *
@@ -127,6 +299,29 @@ extern "C"
    */
   struct mgos_sh1106 *mgos_sh1106_create (const struct mgos_config_sh1106 *cfg);
 
+  /**
+   * @brief Initialize the SH1106 driver in caller-provided storage, without any
+   * heap allocation. Closing the handle leaves the storage to the caller.
+   *
+   * @param cfg SH1106 configuration.
+   * @param storage Storage for the instance and default canvas; typically a static variable.
+   *
+   * @return SH1106 driver handle, or NULL if setup failed.
+   */
+  struct mgos_sh1106 *mgos_sh1106_create_static (const struct mgos_config_sh1106 *cfg, mgos_sh1106_storage_t *storage);
+
+  /**
+   * @brief Route the driver's allocations (instances from `mgos_sh1106_create()`,
+   * canvases and surfaces) through custom hooks, e.g. to place them in a chosen
+   * memory region or arena. Pass NULL hooks to restore calloc/free. With an
+   * allocator but no release hook, memory is never returned.
+   *
+   * @param alloc Allocation hook; memory is zeroed by the driver.
+   * @param release Release hook, may be NULL.
+   * @param ctx Opaque pointer passed to both hooks.
+   */
+  void mgos_sh1106_set_allocator (void *(*alloc) (size_t size, void *ctx), void (*release) (void *ptr, void *ctx), void *ctx);
+
   /**
    * @brief Power down the display, close I2C connection, and free memory.
    *
@@ -139,7 +334,7 @@ extern "C"
    *
    * @param oled SH1106 driver handle
    *
-   * @return Screen width, in pixels.
+   * @return Screen width, in pixels, as seen by drawing in the current rotation.
    */
   uint8_t mgos_sh1106_get_width (struct mgos_sh1106 *oled);
 
@@ -148,12 +343,36 @@ extern "C"
    *
    * @param oled SH1106 driver handle
    *
-   * @return Screen height, in pixels.
+   * @return Screen height, in pixels, as seen by drawing in the current rotation.
    */
   uint8_t mgos_sh1106_get_height (struct mgos_sh1106 *oled);
 
   /**
-   * @brief Clear the screen bitmap.
+   * @brief Rotate drawing on the panel. While rotated, drawing with the canvas
+   * as target goes to a surface in the rotated orientation (90 and 270 swap
+   * width and height), which `mgos_sh1106_refresh()` copies onto the canvas
+   * under the viewport in 8x8 blocks, transforming the dirty window with it.
+   * The surface starts blank; gray levels draw as black or white on it.
+   * Scrolling and viewport calls still act on the unrotated canvas.
+   *
+   * @param oled SH1106 driver handle.
+   * @param rotation Rotation.
+   *
+   * @return False on allocation failure.
+   */
+  bool mgos_sh1106_set_rotation (struct mgos_sh1106 *oled, mgos_sh1106_rotation_t rotation);
+
+  /**
+   * @brief Get the rotation set with `mgos_sh1106_set_rotation()`.
+   *
+   * @param oled SH1106 driver handle.
+   *
+   * @return Current rotation.
+   */
+  mgos_sh1106_rotation_t mgos_sh1106_get_rotation (struct mgos_sh1106 *oled);
+
+  /**
+   * @brief Clear the screen bitmap, or the surface selected with `mgos_sh1106_set_target()`.
    *
    * @param oled SH1106 driver handle.
    */
@@ -161,13 +380,279 @@ extern "C"
 
   /**
    * @brief Refresh the display, sending any dirty regions to the OLED controller for display.
-   * Call this after you are finished calling any drawing primitives.
+   * Call this after you are finished calling any drawing primitives. In auto
+   * refresh mode this only records the request; the next frame sends it.
    *
    * @param oled SH1106 driver handle.
    * @param force Redraw the entire bitmap, not just dirty regions.
    */
   void mgos_sh1106_refresh (struct mgos_sh1106 *oled, bool force);
 
+  /**
+   * @brief Scroll the whole canvas vertically using the controller's display
+   * start line. The controller RAM caches 64 canvas rows as a ring: contents move
+   * with the panel so drawing coordinates stay the same, and only the cached rows
+   * whose RAM rows now hold other content are marked dirty, so the next refresh
+   * sends just the pages they occupy. Rows shifted in at the canvas edge are
+   * cleared. On panels shorter than 64 rows, rows already drawn below the panel
+   * scroll into view without any data transfer.
+   *
+   * @param oled SH1106 driver handle.
+   * @param lines Rows to scroll; positive moves content up, negative moves it down.
+   */
+  void mgos_sh1106_scroll_vertical (struct mgos_sh1106 *oled, int16_t lines);
+
+  /**
+   * @brief Get the current display start line.
+   *
+   * @param oled SH1106 driver handle.
+   *
+   * @return Controller RAM row shown on the first panel row.
+   */
+  uint8_t mgos_sh1106_get_start_line (struct mgos_sh1106 *oled);
+
+  /**
+   * @brief Replace the drawing canvas with a blank one of the given size. All
+   * drawing primitives use canvas coordinates; the panel shows the part of it
+   * under the viewport. The default canvas is the 132x64 controller RAM.
+   *
+   * @param oled SH1106 driver handle.
+   * @param width Canvas width, at least the panel width.
+   * @param height Canvas height, at least the panel height; rounded up to a whole page.
+   *
+   * @return True on success; on failure, or in SH1106_FIXED_GEOMETRY builds,
+   * the current canvas is kept.
+   */
+  bool mgos_sh1106_set_canvas (struct mgos_sh1106 *oled, uint16_t width, uint16_t height);
+
+  /**
+   * @brief Turn 4-level grayscale on or off. A second bit-plane is kept next to
+   * the canvas and a repeating timer cycles the panel through three subframes,
+   * resending only the visible pages that hold gray pixels. Drawing with the
+   * gray colors sets a pixel's gray bit, black and white clear it. Blits and
+   * `mgos_sh1106_update_buffer()` only touch the mono plane. Changing the canvas
+   * turns gray mode off.
+   *
+   * @param oled SH1106 driver handle.
+   * @param enable Allocate the gray plane and start the subframe timer, or stop it and free the plane.
+   * @param subframe_hz Requested subframes per second; three make one gray frame.
+   *
+   * @return True on success.
+   */
+  bool mgos_sh1106_set_gray_mode (struct mgos_sh1106 *oled, bool enable, uint16_t subframe_hz);
+
+  /**
+   * @brief Get the subframe rate gray mode actually achieved since it was
+   * turned on or the rate was last reset.
+   *
+   * @param oled SH1106 driver handle.
+   * @param reset Start measuring a new period afterwards.
+   *
+   * @return Subframes per second, 0 when gray mode is off.
+   */
+  float mgos_sh1106_get_gray_rate (struct mgos_sh1106 *oled, bool reset);
+
+  /**
+   * @brief Turn auto refresh on or off. A repeating timer sends the dirty
+   * windows at most fps times per second, so applications only draw: any
+   * number of draws and `mgos_sh1106_refresh()` calls between two frames are
+   * flushed together. With a latency bound shorter than the frame period,
+   * the timer ticks at half the bound and a change is flushed no later than
+   * max_latency_ms after it was drawn, ahead of its frame slot if need be.
+   * Turning it off flushes pending changes.
+   *
+   * @param oled SH1106 driver handle.
+   * @param fps Target frame rate, or 0 to turn auto refresh off.
+   * @param max_latency_ms Longest a change may wait for the bus, or 0 for one frame period.
+   *
+   * @return True on success.
+   */
+  bool mgos_sh1106_set_auto_refresh (struct mgos_sh1106 *oled, uint16_t fps, uint16_t max_latency_ms);
+
+  /**
+   * @brief Get the frame rate and coalescing auto refresh achieved since the
+   * previous call.
+   *
+   * @param oled SH1106 driver handle.
+   * @param stats Filled with the counters, which then restart.
+   *
+   * @return True on success, false when auto refresh is off.
+   */
+  bool mgos_sh1106_get_auto_refresh_stats (struct mgos_sh1106 *oled, struct mgos_sh1106_refresh_stats *stats);
+
+  /**
+   * @brief Tag a canvas region with a refresh priority. Progressive refresh
+   * sends the dirty pages that overlap higher priority regions first; other
+   * pages have priority 0.
+   *
+   * @param oled SH1106 driver handle.
+   * @param slot Region slot, below SH1106_PRIORITY_REGIONS.
+   * @param x Region X coordinate, in canvas pixels.
+   * @param y Region Y coordinate.
+   * @param w Region width.
+   * @param h Region height.
+   * @param priority Priority, or 0 to free the slot.
+   *
+   * @return True on success.
+   */
+  bool mgos_sh1106_set_priority (struct mgos_sh1106 *oled, uint8_t slot, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                 uint8_t priority);
+
+  /**
+   * @brief Refresh within a budget. Dirty pages are sent highest priority
+   * first, see `mgos_sh1106_set_priority()`, until the time or byte budget is
+   * spent; the rest stay dirty for the next call. The first page is always
+   * sent, so a change in the highest priority region waits at most one call.
+   *
+   * @param oled SH1106 driver handle.
+   * @param max_us Time budget in microseconds, or 0 for none.
+   * @param max_bytes Display data budget in bytes, or 0 for none.
+   *
+   * @return True when nothing is left dirty.
+   */
+  bool mgos_sh1106_refresh_progressive (struct mgos_sh1106 *oled, uint32_t max_us, uint32_t max_bytes);
+
+  /**
+   * @brief Create a named screen region. A region has a surface of its own:
+   * drawing into it, see `mgos_sh1106_region_select()`, is clipped to the
+   * region and marks only the region dirty. `mgos_sh1106_refresh_regions()`
+   * sends each region on its own schedule. The region starts with what the
+   * display shows under it.
+   *
+   * @param oled SH1106 driver handle.
+   * @param name Region name, unique on the display; longer names are cut to SH1106_REGION_NAME_LEN - 1.
+   * @param x Region X coordinate on the display.
+   * @param y Region Y coordinate on the display.
+   * @param w Region width.
+   * @param h Region height.
+   * @param min_interval_ms Least time between two transfers of the region.
+   * @param max_interval_ms Most time between two transfers; the region is
+   * resent in full when it is reached, even unchanged. 0 for no limit.
+   *
+   * @return Region handle, or NULL on failure or if the name is taken.
+   */
+  struct mgos_sh1106_region *mgos_sh1106_region_create (struct mgos_sh1106 *oled, const char *name, int16_t x, int16_t y,
+                                                        uint16_t w, uint16_t h, uint32_t min_interval_ms,
+                                                        uint32_t max_interval_ms);
+
+  /**
+   * @brief Look up a region by name.
+   *
+   * @param oled SH1106 driver handle.
+   * @param name Region name.
+   *
+   * @return Region handle, or NULL if there is none.
+   */
+  struct mgos_sh1106_region *mgos_sh1106_region_find (struct mgos_sh1106 *oled, const char *name);
+
+  /**
+   * @brief Draw into a region: select its surface as the drawing target, with
+   * coordinates relative to the region. `mgos_sh1106_set_target()` with NULL
+   * goes back to the display.
+   *
+   * @param oled SH1106 driver handle.
+   * @param region Region handle.
+   *
+   * @return True on success.
+   */
+  bool mgos_sh1106_region_select (struct mgos_sh1106 *oled, struct mgos_sh1106_region *region);
+
+  /**
+   * @brief Delete a region. What it last sent stays on the display.
+   *
+   * @param oled SH1106 driver handle.
+   * @param region Region handle.
+   */
+  void mgos_sh1106_region_free (struct mgos_sh1106 *oled, struct mgos_sh1106_region *region);
+
+  /**
+   * @brief Send the regions that are due: a dirty region once its minimum
+   * interval has passed, any region once its maximum interval has. Each one
+   * is copied to the display and only the RAM pages and columns under it are
+   * sent; other drawing waits for the next refresh. Auto refresh calls this
+   * on every tick.
+   *
+   * @param oled SH1106 driver handle.
+   *
+   * @return Milliseconds until the next region falls due, UINT32_MAX if none will.
+   */
+  uint32_t mgos_sh1106_refresh_regions (struct mgos_sh1106 *oled);
+
+  /**
+   * @brief Get the latency from drawing to the panel: the time from the
+   * first dirty mark after a refresh to the end of the bus transfer that
+   * sent it, through rotation and regions. Needs SH1106_LATENCY_STATS. When
+   * the app also includes the rpc-common library, the global display is
+   * served by the SH1106.Latency RPC, which takes an optional {reset: true}.
+   *
+   * @param oled SH1106 driver handle.
+   * @param stats Filled with the percentiles.
+   * @param reset Start a new histogram afterwards.
+   *
+   * @return True on success, false when built without SH1106_LATENCY_STATS.
+   */
+  bool mgos_sh1106_get_latency (struct mgos_sh1106 *oled, struct mgos_sh1106_latency_stats *stats, bool reset);
+
+  /**
+   * @brief Get the canvas width.
+   *
+   * @param oled SH1106 driver handle.
+   *
+   * @return Canvas width, in pixels.
+   */
+  uint16_t mgos_sh1106_get_canvas_width (struct mgos_sh1106 *oled);
+
+  /**
+   * @brief Get the canvas height.
+   *
+   * @param oled SH1106 driver handle.
+   *
+   * @return Canvas height, in pixels.
+   */
+  uint16_t mgos_sh1106_get_canvas_height (struct mgos_sh1106 *oled);
+
+  /**
+   * @brief Move the panel's view over the canvas. Refresh sends dirty canvas
+   * areas straight from the canvas at the viewport offset. Vertical moves that
+   * stay within the 64 canvas rows cached in controller RAM only change the
+   * display start line and send no pixel data unless the newly shown rows were
+   * drawn while off screen. The controller has no column start register, so
+   * horizontal moves resend the visible pages.
+   *
+   * @param oled SH1106 driver handle.
+   * @param x Canvas column shown at the left edge of the panel.
+   * @param y Canvas row shown at the top of the panel; on the default canvas rows
+   * wrap around at 64.
+   */
+  void mgos_sh1106_set_viewport (struct mgos_sh1106 *oled, uint16_t x, uint16_t y);
+
+  /**
+   * @brief Move the viewport relative to its current position.
+   *
+   * @param oled SH1106 driver handle.
+   * @param dx Columns to move right (negative moves left).
+   * @param dy Rows to move down (negative moves up).
+   */
+  void mgos_sh1106_pan (struct mgos_sh1106 *oled, int16_t dx, int16_t dy);
+
+  /**
+   * @brief Get the buffer column shown at the left edge of the panel.
+   *
+   * @param oled SH1106 driver handle.
+   *
+   * @return Viewport X position.
+   */
+  uint16_t mgos_sh1106_get_viewport_x (struct mgos_sh1106 *oled);
+
+  /**
+   * @brief Get the buffer row shown at the top of the panel.
+   *
+   * @param oled SH1106 driver handle.
+   *
+   * @return Viewport Y position.
+   */
+  uint16_t mgos_sh1106_get_viewport_y (struct mgos_sh1106 *oled);
+
   /**
    * @brief Draw a single pixel.
    *
@@ -176,7 +661,7 @@ extern "C"
    * @param y Y coordinate.
    * @param color Pixel color.
    */
-  void mgos_sh1106_draw_pixel (struct mgos_sh1106 *oled, int8_t x, int8_t y,
+  void mgos_sh1106_draw_pixel (struct mgos_sh1106 *oled, int16_t x, int16_t y,
                                 mgos_sh1106_color_t color);
 
   /**
@@ -188,7 +673,7 @@ extern "C"
    * @param w Line length.
    * @param color Line color.
    */
-  void mgos_sh1106_draw_hline (struct mgos_sh1106 *oled, int8_t x, int8_t y, uint8_t w,
+  void mgos_sh1106_draw_hline (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint16_t w,
                                 mgos_sh1106_color_t color);
 
   /**
@@ -200,7 +685,7 @@ extern "C"
    * @param h Line length.
    * @param color Line color.
    */
-  void mgos_sh1106_draw_vline (struct mgos_sh1106 *oled, int8_t x, int8_t y, uint8_t h,
+  void mgos_sh1106_draw_vline (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint16_t h,
                                 mgos_sh1106_color_t color);
 
   /**
@@ -213,7 +698,7 @@ extern "C"
    * @param h Rectangle height.
    * @param color Line color.
    */
-  void mgos_sh1106_draw_rectangle (struct mgos_sh1106 *oled, int8_t x, int8_t y, uint8_t w, uint8_t h,
+  void mgos_sh1106_draw_rectangle (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
                                     mgos_sh1106_color_t color);
 
   /**
@@ -226,7 +711,7 @@ extern "C"
    * @param h Rectangle height.
    * @param color Line and fill color.
    */
-  void mgos_sh1106_fill_rectangle (struct mgos_sh1106 *oled, int8_t x, int8_t y, uint8_t w, uint8_t h,
+  void mgos_sh1106_fill_rectangle (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
                                     mgos_sh1106_color_t color);
 
   /**
@@ -238,7 +723,7 @@ extern "C"
    * @param r Radius.
    * @param color Line color.
    */
-  void mgos_sh1106_draw_circle (struct mgos_sh1106 *oled, int8_t x0, int8_t y0, uint8_t r, mgos_sh1106_color_t color);
+  void mgos_sh1106_draw_circle (struct mgos_sh1106 *oled, int16_t x0, int16_t y0, uint16_t r, mgos_sh1106_color_t color);
 
   /**
    * @brief Draw a filled circle.
@@ -249,16 +734,25 @@ extern "C"
    * @param r Radius.
    * @param color Line and fill color.
    */
-  void mgos_sh1106_fill_circle (struct mgos_sh1106 *oled, int8_t x0, int8_t y0, uint8_t r, mgos_sh1106_color_t color);
+  void mgos_sh1106_fill_circle (struct mgos_sh1106 *oled, int16_t x0, int16_t y0, uint16_t r, mgos_sh1106_color_t color);
 
   /**
    * @brief Select active font ID.
    *
    * @param oled SH1106 driver handle.
-   * @param font Font index; see `fonts.h`.
+   * @param font Font ID from the registry: a built-in font (see `fonts.h`) or
+   * one added with `font_register()`. Unknown IDs keep the current font.
    */
   void mgos_sh1106_select_font (struct mgos_sh1106 *oled, uint8_t font);
 
+  /**
+   * @brief Make any font the active font, e.g. one from an asset pack.
+   *
+   * @param oled SH1106 driver handle.
+   * @param font Font, which must stay valid while it is in use.
+   */
+  void mgos_sh1106_set_font (struct mgos_sh1106 *oled, const font_info_t *font);
+
   /**
    * @brief Draw a single character using the active font and selected colors.
    *
@@ -271,11 +765,30 @@ extern "C"
    *
    * @return Character width in pixels
    */
-  uint8_t mgos_sh1106_draw_char (struct mgos_sh1106 *oled, uint8_t x, uint8_t y, unsigned char c,
+  uint8_t mgos_sh1106_draw_char (struct mgos_sh1106 *oled, int16_t x, int16_t y, unsigned char c,
                                   mgos_sh1106_color_t foreground, mgos_sh1106_color_t background);
 
   /**
-   * @brief Draw a string using the active font and selected colors.
+   * @brief Draw the glyph of a Unicode code point using the active font. Code
+   * points the font lacks are drawn as '?', or ' ' if the font has no '?'.
+   *
+   * @param oled SH1106 driver handle.
+   * @param x X coordinate.
+   * @param y Y coordinate.
+   * @param cp Code point to draw.
+   * @param foreground Foreground color.
+   * @param background Background color.
+   *
+   * @return Character width in pixels
+   */
+  uint8_t mgos_sh1106_draw_codepoint (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint32_t cp,
+                                       mgos_sh1106_color_t foreground, mgos_sh1106_color_t background);
+
+  /**
+   * @brief Draw a UTF-8 string using the active font and selected colors.
+   * Bytes that are not valid UTF-8, or whose sequence decodes to a code point
+   * the font has no glyph for, are drawn as byte-indexed characters. A byte
+   * pair that is also valid UTF-8 (such as 0xC3 0xA9) draws as one character.
    *
    * @param oled SH1106 driver handle.
    * @param x X coordinate.
@@ -286,7 +799,7 @@ extern "C"
    *
    * @return String witdth in pixels.
    */
-  uint8_t mgos_sh1106_draw_string_color (struct mgos_sh1106 *oled, uint8_t x, uint8_t y, char *str,
+  uint16_t mgos_sh1106_draw_string_color (struct mgos_sh1106 *oled, int16_t x, int16_t y, char *str,
                                           mgos_sh1106_color_t foreground, mgos_sh1106_color_t background);
 
   /**
@@ -299,17 +812,216 @@ extern "C"
    *
    * @return String width in pixels.
    */
-  uint8_t mgos_sh1106_draw_string (struct mgos_sh1106 *oled, uint8_t x, uint8_t y, char *str);
+  uint16_t mgos_sh1106_draw_string (struct mgos_sh1106 *oled, int16_t x, int16_t y, char *str);
 
   /**
-   * @brief Measure on-screen width of string if drawn using active font.
+   * @brief Measure on-screen width of a UTF-8 string if drawn using active font.
    *
    * @param oled SH1106 driver handle.
    * @param str String to measure.
    *
    * @return String width in pixels.
    */
-  uint8_t mgos_sh1106_measure_string (struct mgos_sh1106 *oled, char *str);
+  uint16_t mgos_sh1106_measure_string (struct mgos_sh1106 *oled, char *str);
+
+  /**
+   * @brief Measure at most `len` bytes of a UTF-8 string, stopping early at
+   * a NUL; for buffers that are not NUL-terminated.
+   *
+   * @param oled SH1106 driver handle.
+   * @param str String to measure.
+   * @param len Bytes to measure.
+   *
+   * @return String width in pixels.
+   */
+  uint16_t mgos_sh1106_measure_string_n (struct mgos_sh1106 *oled, const char *str, size_t len);
+
+  /**
+   * @brief Break a UTF-8 string into lines for a box, in one pass over the
+   * string. Lines end at '\n', and, with `SH1106_TEXT_WRAP`, at the last
+   * space that fits; without it, text past the box edge is clipped. With
+   * `SH1106_TEXT_ELLIPSIS`, clipped lines, and the last line when text is
+   * left over, end in an ellipsis (U+2026 if the font has it, else "...").
+   *
+   * The layout refers to the string by offset, so it stays valid while the
+   * string and the active font do. Scrolling views can keep it, or lay out
+   * the rest of a long text from `layout->next`.
+   *
+   * @param oled SH1106 driver handle.
+   * @param width Box width in pixels.
+   * @param height Box height in pixels, 0 to fill the layout.
+   * @param str String to lay out.
+   * @param flags Combination of mgos_sh1106_text_flags_t.
+   * @param layout Layout to fill.
+   *
+   * @return Lines laid out, at most SH1106_TEXT_MAX_LINES.
+   */
+  uint16_t mgos_sh1106_layout_text (struct mgos_sh1106 *oled, uint16_t width, uint16_t height, const char *str,
+                                    uint16_t flags, struct mgos_sh1106_text_layout *layout);
+
+  /**
+   * @brief Draw laid out lines, starting at line `first`, as many as fit in
+   * the box, aligned as the layout flags ask.
+   *
+   * @param oled SH1106 driver handle.
+   * @param x X coordinate of the box.
+   * @param y Y coordinate of the box.
+   * @param w Box width.
+   * @param h Box height, 0 to draw all lines from `first`.
+   * @param str String the layout was made from.
+   * @param layout Layout from `mgos_sh1106_layout_text()`.
+   * @param first First line to draw.
+   * @param foreground Foreground color.
+   * @param background Background color.
+   *
+   * @return Lines drawn.
+   */
+  uint16_t mgos_sh1106_draw_text_layout (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                         const char *str, const struct mgos_sh1106_text_layout *layout, uint16_t first,
+                                         mgos_sh1106_color_t foreground, mgos_sh1106_color_t background);
+
+  /**
+   * @brief Lay out and draw a UTF-8 string in a box using the active font
+   * and default colors (white on transparent).
+   *
+   * @param oled SH1106 driver handle.
+   * @param x X coordinate of the box.
+   * @param y Y coordinate of the box.
+   * @param w Box width.
+   * @param h Box height.
+   * @param str String to draw.
+   * @param flags Combination of mgos_sh1106_text_flags_t.
+   * @param layout Receives the layout metrics and line breaks, or NULL.
+   *
+   * @return Lines drawn.
+   */
+  uint16_t mgos_sh1106_draw_text_box (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                      const char *str, uint16_t flags, struct mgos_sh1106_text_layout *layout);
+
+  /**
+   * @brief Create a numeric field: a number drawn right-aligned in `cells`
+   * fixed-width character cells, each as wide as the widest digit, sign,
+   * point or colon of the active font. Updates redraw only the cells whose
+   * character changed, so only those are dirtied and sent on refresh.
+   *
+   * @param oled SH1106 driver handle.
+   * @param x X coordinate of the first cell.
+   * @param y Y coordinate of the cells.
+   * @param cells Number of cells, 1 to 16.
+   * @param format Number format.
+   * @param decimals Digits after the point for `SH1106_NUMERIC_FIXED`, at most 9.
+   * @param foreground Digit color.
+   * @param background Cell color; transparent is taken as black since
+   * changed cells have to be erased.
+   *
+   * @return Field handle, or NULL on bad arguments or allocation failure.
+   */
+  struct mgos_sh1106_numeric *mgos_sh1106_numeric_create (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint8_t cells,
+                                                          mgos_sh1106_numeric_format_t format, uint8_t decimals,
+                                                          mgos_sh1106_color_t foreground, mgos_sh1106_color_t background);
+
+  /**
+   * @brief Show a value in a numeric field, drawing the changed cells into the
+   * current target. Values too wide for the field show as dashes.
+   *
+   * @param oled SH1106 driver handle.
+   * @param field Numeric field.
+   * @param value Value to show.
+   *
+   * @return False if the value did not fit.
+   */
+  bool mgos_sh1106_numeric_set (struct mgos_sh1106 *oled, struct mgos_sh1106_numeric *field, int32_t value);
+
+  /**
+   * @brief Forget what a numeric field shows, so the next update redraws every
+   * cell; for use after the area was cleared or drawn over.
+   *
+   * @param field Numeric field.
+   */
+  void mgos_sh1106_numeric_invalidate (struct mgos_sh1106_numeric *field);
+
+  /**
+   * @brief Width of a numeric field in pixels.
+   *
+   * @param field Numeric field.
+   *
+   * @return Width of all cells and the spacing between them.
+   */
+  uint16_t mgos_sh1106_numeric_get_width (const struct mgos_sh1106_numeric *field);
+
+  /**
+   * @brief Free a numeric field. Its pixels stay on the canvas.
+   *
+   * @param field Numeric field.
+   */
+  void mgos_sh1106_numeric_free (struct mgos_sh1106_numeric *field);
+
+  /**
+   * @brief Create a strip chart: a plot area that scrolls left one column for
+   * every `per_column` samples, each column showing the min/max envelope of
+   * its samples joined to the previous one. The area is cleared to the
+   * background, and must lie inside the target surface.
+   *
+   * @param oled SH1106 driver handle.
+   * @param x X coordinate of the plot area.
+   * @param y Y coordinate of the plot area.
+   * @param width Plot width, one column per pixel.
+   * @param height Plot height.
+   * @param lo Value plotted on the bottom row; lower values are clamped.
+   * @param hi Value plotted on the top row; higher values are clamped.
+   * @param per_column Samples decimated into each column, at least 1.
+   * @param foreground Trace color.
+   * @param background Plot color; transparent is taken as black.
+   *
+   * @return Chart handle, or NULL on bad arguments or allocation failure.
+   */
+  struct mgos_sh1106_chart *mgos_sh1106_chart_create (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint16_t width,
+                                                      uint16_t height, int32_t lo, int32_t hi, uint16_t per_column,
+                                                      mgos_sh1106_color_t foreground, mgos_sh1106_color_t background);
+
+  /**
+   * @brief Add samples to a strip chart. The plot is shifted once by the
+   * number of columns completed and only those columns are drawn, so the
+   * cost of a call is bounded by the plot size whatever the sample rate.
+   *
+   * @param oled SH1106 driver handle.
+   * @param chart Strip chart.
+   * @param samples Sample values.
+   * @param count Number of samples.
+   *
+   * @return False if the plot no longer fits the target surface.
+   */
+  bool mgos_sh1106_chart_add (struct mgos_sh1106 *oled, struct mgos_sh1106_chart *chart, const int32_t *samples, size_t count);
+
+  /**
+   * @brief Change the value range of a strip chart and redraw it.
+   *
+   * @param oled SH1106 driver handle.
+   * @param chart Strip chart.
+   * @param lo Value plotted on the bottom row.
+   * @param hi Value plotted on the top row, above `lo`.
+   *
+   * @return False on a bad range or if the plot does not fit the target.
+   */
+  bool mgos_sh1106_chart_set_range (struct mgos_sh1106 *oled, struct mgos_sh1106_chart *chart, int32_t lo, int32_t hi);
+
+  /**
+   * @brief Redraw a whole strip chart from its column history, e.g. after the
+   * area was cleared or drawn over.
+   *
+   * @param oled SH1106 driver handle.
+   * @param chart Strip chart.
+   *
+   * @return False if the plot does not fit the target surface.
+   */
+  bool mgos_sh1106_chart_redraw (struct mgos_sh1106 *oled, struct mgos_sh1106_chart *chart);
+
+  /**
+   * @brief Free a strip chart. Its pixels stay on the canvas.
+   *
+   * @param chart Strip chart.
+   */
+  void mgos_sh1106_chart_free (struct mgos_sh1106_chart *chart);
 
   /**
    * @brief Get the height of the active font.
@@ -349,7 +1061,337 @@ extern "C"
   void mgos_sh1106_flip_display (struct mgos_sh1106 *oled, bool horizontal, bool vertical);
 
   /**
-   * @brief Copy pre-rendered bytes directly into the bitmap.
+   * @brief Allocate a blank off-screen surface in the same page format as the
+   * display canvas.
+   *
+   * @param width Surface width, in pixels.
+   * @param height Surface height, in pixels; rounded up to a whole page.
+   *
+   * @return Surface handle, or NULL if allocation failed.
+   */
+  struct mgos_sh1106_surface *mgos_sh1106_surface_create (uint16_t width, uint16_t height);
+
+  /**
+   * @brief Free a surface. It must not be the current drawing target.
+   *
+   * @param surface Surface handle.
+   */
+  void mgos_sh1106_surface_free (struct mgos_sh1106_surface *surface);
+
+  /**
+   * @brief Get surface width.
+   *
+   * @param surface Surface handle.
+   *
+   * @return Surface width, in pixels.
+   */
+  uint16_t mgos_sh1106_surface_get_width (const struct mgos_sh1106_surface *surface);
+
+  /**
+   * @brief Get surface height.
+   *
+   * @param surface Surface handle.
+   *
+   * @return Surface height, in pixels.
+   */
+  uint16_t mgos_sh1106_surface_get_height (const struct mgos_sh1106_surface *surface);
+
+  /**
+   * @brief Select where drawing primitives, text, `mgos_sh1106_clear()` and
+   * `mgos_sh1106_blit()` render. Coordinates are relative to the target.
+   *
+   * @param oled SH1106 driver handle.
+   * @param surface Surface to draw into, or NULL for the display canvas (the
+   * rotated surface while a rotation is set).
+   */
+  void mgos_sh1106_set_target (struct mgos_sh1106 *oled, struct mgos_sh1106_surface *surface);
+
+  /**
+   * @brief Composite a region of a surface onto the current drawing target.
+   * Rows are copied a page at a time, with a plain memcpy when the source and
+   * destination rows are page aligned and the operation is a copy. The source
+   * may be the target itself, and the two areas may overlap.
+   *
+   * @param oled SH1106 driver handle.
+   * @param src Source surface.
+   * @param sx Source region X coordinate.
+   * @param sy Source region Y coordinate.
+   * @param w Region width.
+   * @param h Region height.
+   * @param dx Destination X coordinate.
+   * @param dy Destination Y coordinate.
+   * @param rop How source pixels combine with the destination.
+   */
+  void mgos_sh1106_blit (struct mgos_sh1106 *oled, const struct mgos_sh1106_surface *src, int16_t sx, int16_t sy,
+                         uint16_t w, uint16_t h, int16_t dx, int16_t dy, mgos_sh1106_rop_t rop);
+
+  /**
+   * @brief Move a region of the current drawing target within it, e.g. to
+   * scroll part of the screen. Overlapping regions are handled. A move
+   * within the same rows is a memmove per page; other moves shift bits
+   * across page boundaries. Only the destination, and the exposed area when
+   * it is filled, is marked for refresh.
+   *
+   * @param oled SH1106 driver handle.
+   * @param sx Source region X coordinate.
+   * @param sy Source region Y coordinate.
+   * @param w Region width.
+   * @param h Region height.
+   * @param dx Destination X coordinate.
+   * @param dy Destination Y coordinate.
+   * @param fill Color for the part of the source the destination does not
+   * cover, or SH1106_COLOR_TRANSPARENT to leave it as is.
+   */
+  void mgos_sh1106_copy_rect (struct mgos_sh1106 *oled, int16_t sx, int16_t sy, uint16_t w, uint16_t h, int16_t dx,
+                              int16_t dy, mgos_sh1106_color_t fill);
+
+  /**
+   * @brief Dither an 8-bit grayscale image onto the current drawing target.
+   * Pixels are written a page (8 rows) at a time; on a canvas in gray mode the
+   * image is dithered to the four gray levels. The image is clipped to the target.
+   *
+   * @param oled SH1106 driver handle.
+   * @param x Destination X coordinate.
+   * @param y Destination Y coordinate.
+   * @param width Image width.
+   * @param height Image height.
+   * @param pixels Row-major pixels, 0 black to 255 white.
+   * @param stride Bytes from one row to the next, 0 for width.
+   * @param dither Dithering method.
+   *
+   * @return False if the working band could not be allocated.
+   */
+  bool mgos_sh1106_draw_gray_image (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint16_t width, uint16_t height,
+                                    const uint8_t *pixels, size_t stride, mgos_sh1106_dither_t dither);
+
+  /**
+   * @brief Start dithering a grayscale image whose rows arrive in pieces. Only
+   * one page band and, for error diffusion, two rows of error terms are kept.
+   *
+   * @param oled SH1106 driver handle.
+   * @param x Destination X coordinate.
+   * @param y Destination Y coordinate.
+   * @param width Image width.
+   * @param height Image height.
+   * @param dither Dithering method.
+   *
+   * @return Stream handle, or NULL on allocation failure.
+   */
+  struct mgos_sh1106_gray_stream *mgos_sh1106_gray_stream_begin (struct mgos_sh1106 *oled, int16_t x, int16_t y,
+                                                                uint16_t width, uint16_t height, mgos_sh1106_dither_t dither);
+
+  /**
+   * @brief Feed the next image rows to a grayscale stream.
+   *
+   * @param stream Stream handle.
+   * @param rows Row-major pixels of the next rows.
+   * @param count Number of rows.
+   * @param stride Bytes from one row to the next, 0 for the image width.
+   *
+   * @return Rows consumed; rows past the image height are ignored.
+   */
+  uint16_t mgos_sh1106_gray_stream_rows (struct mgos_sh1106_gray_stream *stream, const uint8_t *rows, uint16_t count, size_t stride);
+
+  /**
+   * @brief Write the last partial band and free the stream. Rows never fed are left untouched.
+   *
+   * @param stream Stream handle.
+   */
+  void mgos_sh1106_gray_stream_end (struct mgos_sh1106_gray_stream *stream);
+
+  /**
+   * @brief Draw a complete 1-bpp image (PBM, XBM or BMP) held in memory, see
+   * `mgos_sh1106_image_begin()`.
+   *
+   * @param oled SH1106 driver handle.
+   * @param x Destination X coordinate.
+   * @param y Destination Y coordinate.
+   * @param format Image file format.
+   * @param data Image file contents.
+   * @param len Length of data.
+   * @param foreground Color of ink pixels.
+   * @param background Color of paper pixels, or SH1106_COLOR_TRANSPARENT.
+   *
+   * @return True if the whole image was decoded.
+   */
+  bool mgos_sh1106_draw_image (struct mgos_sh1106 *oled, int16_t x, int16_t y, mgos_sh1106_image_format_t format,
+                               const void *data, size_t len, mgos_sh1106_color_t foreground, mgos_sh1106_color_t background);
+
+  /**
+   * @brief Start decoding a 1-bpp image onto the current drawing target. Input
+   * can then be fed in chunks of any size, e.g. straight from a file, an RPC
+   * frame or flash. Pixels are painted one destination page at a time, so only
+   * a band of 8 rows of the visible columns is kept in memory. Ink pixels are
+   * PBM and XBM 1 bits and the darker BMP palette entry. The image is clipped
+   * to the target.
+   *
+   * @param oled SH1106 driver handle.
+   * @param x Destination X coordinate.
+   * @param y Destination Y coordinate.
+   * @param format Image file format.
+   * @param foreground Color of ink pixels.
+   * @param background Color of paper pixels, or SH1106_COLOR_TRANSPARENT.
+   *
+   * @return Decoder handle, or NULL on allocation failure.
+   */
+  struct mgos_sh1106_image_decoder *mgos_sh1106_image_begin (struct mgos_sh1106 *oled, int16_t x, int16_t y,
+                                                            mgos_sh1106_image_format_t format,
+                                                            mgos_sh1106_color_t foreground, mgos_sh1106_color_t background);
+
+  /**
+   * @brief Feed the next chunk of image data. Bytes after the end of the image are ignored.
+   *
+   * @param decoder Decoder handle.
+   * @param data Image data.
+   * @param len Length of data.
+   *
+   * @return False once the data is found to be malformed or unsupported.
+   */
+  bool mgos_sh1106_image_feed (struct mgos_sh1106_image_decoder *decoder, const void *data, size_t len);
+
+  /**
+   * @brief Get the image size, known once its header has been fed.
+   *
+   * @param decoder Decoder handle.
+   * @param width Where to store the width, may be NULL.
+   * @param height Where to store the height, may be NULL.
+   *
+   * @return True if the size is known.
+   */
+  bool mgos_sh1106_image_get_size (const struct mgos_sh1106_image_decoder *decoder, uint16_t *width, uint16_t *height);
+
+  /**
+   * @brief Paint any rows still held in the band and free the decoder.
+   *
+   * @param decoder Decoder handle.
+   *
+   * @return True if the whole image was decoded.
+   */
+  bool mgos_sh1106_image_end (struct mgos_sh1106_image_decoder *decoder);
+
+  /**
+   * @brief Get the size of a packed page image made by tools/sh1106_pack.py.
+   *
+   * @param data Packed image.
+   * @param len Length of data.
+   * @param width Where to store the width, may be NULL.
+   * @param height Where to store the height (whole pages), may be NULL.
+   *
+   * @return False if data is not a packed image.
+   */
+  bool mgos_sh1106_packed_get_size (const uint8_t *data, size_t len, uint16_t *width, uint16_t *height);
+
+  /**
+   * @brief Decompress a packed page image onto the current drawing target.
+   * Page aligned copies store decoded bytes directly; otherwise each byte is
+   * split over two destination pages. The image is clipped to the target.
+   *
+   * @param oled SH1106 driver handle.
+   * @param x Destination X coordinate.
+   * @param y Destination Y coordinate.
+   * @param data Packed image.
+   * @param len Length of data.
+   * @param rop How image pixels combine with the destination.
+   *
+   * @return False if the data is not a packed image or is truncated.
+   */
+  bool mgos_sh1106_draw_packed (struct mgos_sh1106 *oled, int16_t x, int16_t y, const uint8_t *data, size_t len, mgos_sh1106_rop_t rop);
+
+  /**
+   * @brief Decompress a packed page image straight into the display RAM at the
+   * panel's top-left, a page at a time, without touching the canvas. The image
+   * stays on screen until the next refresh, which restores the canvas on the
+   * pages it covered. If a fine scroll left panel pages unaligned with RAM
+   * pages, the image is drawn into the canvas at the viewport and refreshed.
+   *
+   * @param oled SH1106 driver handle.
+   * @param data Packed image.
+   * @param len Length of data.
+   *
+   * @return False if the data is not a packed image or is truncated.
+   */
+  bool mgos_sh1106_show_packed (struct mgos_sh1106 *oled, const uint8_t *data, size_t len);
+
+  /**
+   * @brief Open an asset pack (see tools/sh1106_assets.py) in a flash data
+   * partition. The partition is memory mapped and fonts and images are used in
+   * place; opening only validates the pack index.
+   *
+   * @param label Partition label.
+   *
+   * @return Asset pack handle, or NULL if the partition is missing or invalid
+   * or the platform has no partition mapping.
+   */
+  struct mgos_sh1106_assets *mgos_sh1106_assets_open_partition (const char *label);
+
+  /**
+   * @brief Open an asset pack file through mmap(), on platforms that have it.
+   *
+   * @param path File path.
+   *
+   * @return Asset pack handle, or NULL on failure.
+   */
+  struct mgos_sh1106_assets *mgos_sh1106_assets_open_file (const char *path);
+
+  /**
+   * @brief Use an asset pack already in addressable memory, e.g. linked into
+   * the firmware. The data must outlive the handle.
+   *
+   * @param data Pack contents, 4-byte aligned.
+   * @param len Length of data.
+   *
+   * @return Asset pack handle, or NULL if the pack is invalid.
+   */
+  struct mgos_sh1106_assets *mgos_sh1106_assets_open_memory (const void *data, size_t len);
+
+  /**
+   * @brief Unmap an asset pack. Fonts and images taken from it must no longer be in use.
+   *
+   * @param assets Asset pack handle.
+   */
+  void mgos_sh1106_assets_close (struct mgos_sh1106_assets *assets);
+
+  /**
+   * @brief Look up a font in an asset pack. Its descriptors are checked on the
+   * first lookup; glyph data stays in the mapping.
+   *
+   * @param assets Asset pack handle.
+   * @param name Font name.
+   *
+   * @return Font for `mgos_sh1106_set_font()`, or NULL if missing or invalid.
+   */
+  const font_info_t *mgos_sh1106_assets_font (struct mgos_sh1106_assets *assets, const char *name);
+
+  /**
+   * @brief Draw a packed image or raw bitmap from an asset pack onto the current drawing target.
+   *
+   * @param oled SH1106 driver handle.
+   * @param assets Asset pack handle.
+   * @param name Image name.
+   * @param x Destination X coordinate.
+   * @param y Destination Y coordinate.
+   * @param rop How image pixels combine with the destination.
+   *
+   * @return False if the image is missing or invalid.
+   */
+  bool mgos_sh1106_assets_draw (struct mgos_sh1106 *oled, struct mgos_sh1106_assets *assets, const char *name,
+                                int16_t x, int16_t y, mgos_sh1106_rop_t rop);
+
+  /**
+   * @brief Get the size of an image in an asset pack.
+   *
+   * @param assets Asset pack handle.
+   * @param name Image name.
+   * @param width Where to store the width, may be NULL.
+   * @param height Where to store the height, may be NULL.
+   *
+   * @return False if the image is missing.
+   */
+  bool mgos_sh1106_assets_get_image_size (struct mgos_sh1106_assets *assets, const char *name, uint16_t *width, uint16_t *height);
+
+  /**
+   * @brief Copy pre-rendered bytes directly into the bitmap. The data is a
+   * panel-sized page image and lands at the top-left of the canvas.
    *
    * @param oled SH1106 driver handle.
    * @param data Array containing bytes to copy into buffer.
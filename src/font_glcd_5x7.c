@@ -2314,266 +2314,526 @@ const uint8_t glcd_5x7_bitmaps[] =
 
 };
 
-/* Character descriptors for glcd 5x7 */
-/* { [Char width in bits], [Offset into glcd_5x7_bitmaps in bytes] } */
-const font_char_desc_t glcd_5x7_descriptors[] = 
+/* Character widths for glcd 5x7, in pixels */
+const uint8_t glcd_5x7_widths[] =
 {
-    {5, 0},     /* \x00 */
-    {5, 7},     /* \x01 */
-    {5, 14},    /* \x02 */
-    {5, 21},    /* \x03 */
-    {5, 28},    /* \x04 */
-    {5, 35},    /* \x05 */
-    {5, 42},    /* \x06 */
-    {5, 49},    /* \x07 */
-    {5, 56},    /* \x08 */
-    {5, 63},    /* \x09 */
-    {5, 70},    /* \x0A */
-    {5, 77},    /* \x0B */
-    {5, 84},    /* \x0C */
-    {5, 91},    /* \x0D */
-    {5, 98},    /* \x0E */
-    {5, 105},   /* \x0F */
-    {5, 112},   /* \x10 */
-    {5, 119},   /* \x11 */
-    {5, 126},   /* \x12 */
-    {5, 133},   /* \x13 */
-    {5, 140},   /* \x14 */
-    {5, 147},   /* \x15 */
-    {5, 154},   /* \x16 */
-    {5, 161},   /* \x17 */
-    {5, 168},   /* \x18 */
-    {5, 175},   /* \x19 */
-    {5, 182},   /* \x1A */
-    {5, 189},   /* \x1B */
-    {5, 196},   /* \x1C */
-    {5, 203},   /* \x1D */
-    {5, 210},   /* \x1E */
-    {5, 217},   /* \x1F */
-    {5, 224},   /*      */
-    {5, 231},   /*   !  */
-    {5, 238},   /*   "  */
-    {5, 245},   /*   #  */
-    {5, 252},   /*   $  */
-    {5, 259},   /*   %  */
-    {5, 266},   /*   &  */
-    {5, 273},   /*   '  */
-    {5, 280},   /*   (  */
-    {5, 287},   /*   )  */
-    {5, 294},   /*   *  */
-    {5, 301},   /*   +  */
-    {5, 308},   /*   ,  */
-    {5, 315},   /*   -  */
-    {5, 322},   /*   .  */
-    {5, 329},   /*   /  */
-    {5, 336},   /*   0  */
-    {5, 343},   /*   1  */
-    {5, 350},   /*   2  */
-    {5, 357},   /*   3  */
-    {5, 364},   /*   4  */
-    {5, 371},   /*   5  */
-    {5, 378},   /*   6  */
-    {5, 385},   /*   7  */
-    {5, 392},   /*   8  */
-    {5, 399},   /*   9  */
-    {5, 406},   /*   :  */
-    {5, 413},   /*   ;  */
-    {5, 420},   /*   <  */
-    {5, 427},   /*   =  */
-    {5, 434},   /*   >  */
-    {5, 441},   /*   ?  */
-    {5, 448},   /*   @  */
-    {5, 455},   /*   A  */
-    {5, 462},   /*   B  */
-    {5, 469},   /*   C  */
-    {5, 476},   /*   D  */
-    {5, 483},   /*   E  */
-    {5, 490},   /*   F  */
-    {5, 497},   /*   G  */
-    {5, 504},   /*   H  */
-    {5, 511},   /*   I  */
-    {5, 518},   /*   J  */
-    {5, 525},   /*   K  */
-    {5, 532},   /*   L  */
-    {5, 539},   /*   M  */
-    {5, 546},   /*   N  */
-    {5, 553},   /*   O  */
-    {5, 560},   /*   P  */
-    {5, 567},   /*   Q  */
-    {5, 574},   /*   R  */
-    {5, 581},   /*   S  */
-    {5, 588},   /*   T  */
-    {5, 595},   /*   U  */
-    {5, 602},   /*   V  */
-    {5, 609},   /*   W  */
-    {5, 616},   /*   X  */
-    {5, 623},   /*   Y  */
-    {5, 630},   /*   Z  */
-    {5, 637},   /*   [  */
-    {5, 644},   /*   \  */
-    {5, 651},   /*   ]  */
-    {5, 658},   /*   ^  */
-    {5, 665},   /*   _  */
-    {5, 672},   /*   `  */
-    {5, 679},   /*   a  */
-    {5, 686},   /*   b  */
-    {5, 693},   /*   c  */
-    {5, 700},   /*   d  */
-    {5, 707},   /*   e  */
-    {5, 714},   /*   f  */
-    {5, 721},   /*   g  */
-    {5, 728},   /*   h  */
-    {5, 735},   /*   i  */
-    {5, 742},   /*   j  */
-    {5, 749},   /*   k  */
-    {5, 756},   /*   l  */
-    {5, 763},   /*   m  */
-    {5, 770},   /*   n  */
-    {5, 777},   /*   o  */
-    {5, 784},   /*   p  */
-    {5, 791},   /*   q  */
-    {5, 798},   /*   r  */
-    {5, 805},   /*   s  */
-    {5, 812},   /*   t  */
-    {5, 819},   /*   u  */
-    {5, 826},   /*   v  */
-    {5, 833},   /*   w  */
-    {5, 840},   /*   x  */
-    {5, 847},   /*   y  */
-    {5, 854},   /*   z  */
-    {5, 861},   /*   {  */
-    {5, 868},   /*   |  */
-    {5, 875},   /*   }  */
-    {5, 882},   /*   ~  */
-    {5, 889},   /* \x7F */
-    {5, 896},   /* \x80 */
-    {5, 903},   /* \x81 */
-    {5, 910},   /* \x82 */
-    {5, 917},   /* \x83 */
-    {5, 924},   /* \x84 */
-    {5, 931},   /* \x85 */
-    {5, 938},   /* \x86 */
-    {5, 945},   /* \x87 */
-    {5, 952},   /* \x88 */
-    {5, 959},   /* \x89 */
-    {5, 966},   /* \x8A */
-    {5, 973},   /* \x8B */
-    {5, 980},   /* \x8C */
-    {5, 987},   /* \x8D */
-    {5, 994},   /* \x8E */
-    {5, 1001},  /* \x8F */
-    {5, 1008},  /* \x90 */
-    {5, 1015},  /* \x91 */
-    {5, 1022},  /* \x92 */
-    {5, 1029},  /* \x93 */
-    {5, 1036},  /* \x94 */
-    {5, 1043},  /* \x95 */
-    {5, 1050},  /* \x96 */
-    {5, 1057},  /* \x97 */
-    {5, 1064},  /* \x98 */
-    {5, 1071},  /* \x99 */
-    {5, 1078},  /* \x9A */
-    {5, 1085},  /* \x9B */
-    {5, 1092},  /* \x9C */
-    {5, 1099},  /* \x9D */
-    {5, 1106},  /* \x9E */
-    {5, 1113},  /* \x9F */
-    {5, 1120},  /* \xA0 */
-    {5, 1127},  /* \xA1 */
-    {5, 1134},  /* \xA2 */
-    {5, 1141},  /* \xA3 */
-    {5, 1148},  /* \xA4 */
-    {5, 1155},  /* \xA5 */
-    {5, 1162},  /* \xA6 */
-    {5, 1169},  /* \xA7 */
-    {5, 1176},  /* \xA8 */
-    {5, 1183},  /* \xA9 */
-    {5, 1190},  /* \xAA */
-    {5, 1197},  /* \xAB */
-    {5, 1204},  /* \xAC */
-    {5, 1211},  /* \xAD */
-    {5, 1218},  /* \xAE */
-    {5, 1225},  /* \xAF */
-    {5, 1232},  /* \xB0 */
-    {5, 1239},  /* \xB1 */
-    {5, 1246},  /* \xB2 */
-    {5, 1253},  /* \xB3 */
-    {5, 1260},  /* \xB4 */
-    {5, 1267},  /* \xB5 */
-    {5, 1274},  /* \xB6 */
-    {5, 1281},  /* \xB7 */
-    {5, 1288},  /* \xB8 */
-    {5, 1295},  /* \xB9 */
-    {5, 1302},  /* \xBA */
-    {5, 1309},  /* \xBB */
-    {5, 1316},  /* \xBC */
-    {5, 1323},  /* \xBD */
-    {5, 1330},  /* \xBE */
-    {5, 1337},  /* \xBF */
-    {5, 1344},  /* \xC0 */
-    {5, 1351},  /* \xC1 */
-    {5, 1358},  /* \xC2 */
-    {5, 1365},  /* \xC3 */
-    {5, 1372},  /* \xC4 */
-    {5, 1379},  /* \xC5 */
-    {5, 1386},  /* \xC6 */
-    {5, 1393},  /* \xC7 */
-    {5, 1400},  /* \xC8 */
-    {5, 1407},  /* \xC9 */
-    {5, 1414},  /* \xCA */
-    {5, 1421},  /* \xCB */
-    {5, 1428},  /* \xCC */
-    {5, 1435},  /* \xCD */
-    {5, 1442},  /* \xCE */
-    {5, 1449},  /* \xCF */
-    {5, 1456},  /* \xD0 */
-    {5, 1463},  /* \xD1 */
-    {5, 1470},  /* \xD2 */
-    {5, 1477},  /* \xD3 */
-    {5, 1484},  /* \xD4 */
-    {5, 1491},  /* \xD5 */
-    {5, 1498},  /* \xD6 */
-    {5, 1505},  /* \xD7 */
-    {5, 1512},  /* \xD8 */
-    {5, 1519},  /* \xD9 */
-    {5, 1526},  /* \xDA */
-    {5, 1533},  /* \xDB */
-    {5, 1540},  /* \xDC */
-    {5, 1547},  /* \xDD */
-    {5, 1554},  /* \xDE */
-    {5, 1561},  /* \xDF */
-    {5, 1568},  /* \xE0 */
-    {5, 1575},  /* \xE1 */
-    {5, 1582},  /* \xE2 */
-    {5, 1589},  /* \xE3 */
-    {5, 1596},  /* \xE4 */
-    {5, 1603},  /* \xE5 */
-    {5, 1610},  /* \xE6 */
-    {5, 1617},  /* \xE7 */
-    {5, 1624},  /* \xE8 */
-    {5, 1631},  /* \xE9 */
-    {5, 1638},  /* \xEA */
-    {5, 1645},  /* \xEB */
-    {5, 1652},  /* \xEC */
-    {5, 1659},  /* \xED */
-    {5, 1666},  /* \xEE */
-    {5, 1673},  /* \xEF */
-    {5, 1680},  /* \xF0 */
-    {5, 1687},  /* \xF1 */
-    {5, 1694},  /* \xF2 */
-    {5, 1701},  /* \xF3 */
-    {5, 1708},  /* \xF4 */
-    {5, 1715},  /* \xF5 */
-    {5, 1722},  /* \xF6 */
-    {5, 1729},  /* \xF7 */
-    {5, 1736},  /* \xF8 */
-    {5, 1743},  /* \xF9 */
-    {5, 1750},  /* \xFA */
-    {5, 1757},  /* \xFB */
-    {5, 1764},  /* \xFC */
-    {5, 1771},  /* \xFD */
-    {5, 1778},  /* \xFE */
-    {5, 1785},  /* \xFF */
+    5,   /* \x00 */
+    5,   /* \x01 */
+    5,   /* \x02 */
+    5,   /* \x03 */
+    5,   /* \x04 */
+    5,   /* \x05 */
+    5,   /* \x06 */
+    5,   /* \x07 */
+    5,   /* \x08 */
+    5,   /* \x09 */
+    5,   /* \x0A */
+    5,   /* \x0B */
+    5,   /* \x0C */
+    5,   /* \x0D */
+    5,   /* \x0E */
+    5,   /* \x0F */
+    5,   /* \x10 */
+    5,   /* \x11 */
+    5,   /* \x12 */
+    5,   /* \x13 */
+    5,   /* \x14 */
+    5,   /* \x15 */
+    5,   /* \x16 */
+    5,   /* \x17 */
+    5,   /* \x18 */
+    5,   /* \x19 */
+    5,   /* \x1A */
+    5,   /* \x1B */
+    5,   /* \x1C */
+    5,   /* \x1D */
+    5,   /* \x1E */
+    5,   /* \x1F */
+    5,   /*      */
+    5,   /*   !  */
+    5,   /*   "  */
+    5,   /*   #  */
+    5,   /*   $  */
+    5,   /*   %  */
+    5,   /*   &  */
+    5,   /*   '  */
+    5,   /*   (  */
+    5,   /*   )  */
+    5,   /*   *  */
+    5,   /*   +  */
+    5,   /*   ,  */
+    5,   /*   -  */
+    5,   /*   .  */
+    5,   /*   /  */
+    5,   /*   0  */
+    5,   /*   1  */
+    5,   /*   2  */
+    5,   /*   3  */
+    5,   /*   4  */
+    5,   /*   5  */
+    5,   /*   6  */
+    5,   /*   7  */
+    5,   /*   8  */
+    5,   /*   9  */
+    5,   /*   :  */
+    5,   /*   ;  */
+    5,   /*   <  */
+    5,   /*   =  */
+    5,   /*   >  */
+    5,   /*   ?  */
+    5,   /*   @  */
+    5,   /*   A  */
+    5,   /*   B  */
+    5,   /*   C  */
+    5,   /*   D  */
+    5,   /*   E  */
+    5,   /*   F  */
+    5,   /*   G  */
+    5,   /*   H  */
+    5,   /*   I  */
+    5,   /*   J  */
+    5,   /*   K  */
+    5,   /*   L  */
+    5,   /*   M  */
+    5,   /*   N  */
+    5,   /*   O  */
+    5,   /*   P  */
+    5,   /*   Q  */
+    5,   /*   R  */
+    5,   /*   S  */
+    5,   /*   T  */
+    5,   /*   U  */
+    5,   /*   V  */
+    5,   /*   W  */
+    5,   /*   X  */
+    5,   /*   Y  */
+    5,   /*   Z  */
+    5,   /*   [  */
+    5,   /*   \  */
+    5,   /*   ]  */
+    5,   /*   ^  */
+    5,   /*   _  */
+    5,   /*   `  */
+    5,   /*   a  */
+    5,   /*   b  */
+    5,   /*   c  */
+    5,   /*   d  */
+    5,   /*   e  */
+    5,   /*   f  */
+    5,   /*   g  */
+    5,   /*   h  */
+    5,   /*   i  */
+    5,   /*   j  */
+    5,   /*   k  */
+    5,   /*   l  */
+    5,   /*   m  */
+    5,   /*   n  */
+    5,   /*   o  */
+    5,   /*   p  */
+    5,   /*   q  */
+    5,   /*   r  */
+    5,   /*   s  */
+    5,   /*   t  */
+    5,   /*   u  */
+    5,   /*   v  */
+    5,   /*   w  */
+    5,   /*   x  */
+    5,   /*   y  */
+    5,   /*   z  */
+    5,   /*   {  */
+    5,   /*   |  */
+    5,   /*   }  */
+    5,   /*   ~  */
+    5,   /* \x7F */
+    5,   /* \x80 */
+    5,   /* \x81 */
+    5,   /* \x82 */
+    5,   /* \x83 */
+    5,   /* \x84 */
+    5,   /* \x85 */
+    5,   /* \x86 */
+    5,   /* \x87 */
+    5,   /* \x88 */
+    5,   /* \x89 */
+    5,   /* \x8A */
+    5,   /* \x8B */
+    5,   /* \x8C */
+    5,   /* \x8D */
+    5,   /* \x8E */
+    5,   /* \x8F */
+    5,   /* \x90 */
+    5,   /* \x91 */
+    5,   /* \x92 */
+    5,   /* \x93 */
+    5,   /* \x94 */
+    5,   /* \x95 */
+    5,   /* \x96 */
+    5,   /* \x97 */
+    5,   /* \x98 */
+    5,   /* \x99 */
+    5,   /* \x9A */
+    5,   /* \x9B */
+    5,   /* \x9C */
+    5,   /* \x9D */
+    5,   /* \x9E */
+    5,   /* \x9F */
+    5,   /* \xA0 */
+    5,   /* \xA1 */
+    5,   /* \xA2 */
+    5,   /* \xA3 */
+    5,   /* \xA4 */
+    5,   /* \xA5 */
+    5,   /* \xA6 */
+    5,   /* \xA7 */
+    5,   /* \xA8 */
+    5,   /* \xA9 */
+    5,   /* \xAA */
+    5,   /* \xAB */
+    5,   /* \xAC */
+    5,   /* \xAD */
+    5,   /* \xAE */
+    5,   /* \xAF */
+    5,   /* \xB0 */
+    5,   /* \xB1 */
+    5,   /* \xB2 */
+    5,   /* \xB3 */
+    5,   /* \xB4 */
+    5,   /* \xB5 */
+    5,   /* \xB6 */
+    5,   /* \xB7 */
+    5,   /* \xB8 */
+    5,   /* \xB9 */
+    5,   /* \xBA */
+    5,   /* \xBB */
+    5,   /* \xBC */
+    5,   /* \xBD */
+    5,   /* \xBE */
+    5,   /* \xBF */
+    5,   /* \xC0 */
+    5,   /* \xC1 */
+    5,   /* \xC2 */
+    5,   /* \xC3 */
+    5,   /* \xC4 */
+    5,   /* \xC5 */
+    5,   /* \xC6 */
+    5,   /* \xC7 */
+    5,   /* \xC8 */
+    5,   /* \xC9 */
+    5,   /* \xCA */
+    5,   /* \xCB */
+    5,   /* \xCC */
+    5,   /* \xCD */
+    5,   /* \xCE */
+    5,   /* \xCF */
+    5,   /* \xD0 */
+    5,   /* \xD1 */
+    5,   /* \xD2 */
+    5,   /* \xD3 */
+    5,   /* \xD4 */
+    5,   /* \xD5 */
+    5,   /* \xD6 */
+    5,   /* \xD7 */
+    5,   /* \xD8 */
+    5,   /* \xD9 */
+    5,   /* \xDA */
+    5,   /* \xDB */
+    5,   /* \xDC */
+    5,   /* \xDD */
+    5,   /* \xDE */
+    5,   /* \xDF */
+    5,   /* \xE0 */
+    5,   /* \xE1 */
+    5,   /* \xE2 */
+    5,   /* \xE3 */
+    5,   /* \xE4 */
+    5,   /* \xE5 */
+    5,   /* \xE6 */
+    5,   /* \xE7 */
+    5,   /* \xE8 */
+    5,   /* \xE9 */
+    5,   /* \xEA */
+    5,   /* \xEB */
+    5,   /* \xEC */
+    5,   /* \xED */
+    5,   /* \xEE */
+    5,   /* \xEF */
+    5,   /* \xF0 */
+    5,   /* \xF1 */
+    5,   /* \xF2 */
+    5,   /* \xF3 */
+    5,   /* \xF4 */
+    5,   /* \xF5 */
+    5,   /* \xF6 */
+    5,   /* \xF7 */
+    5,   /* \xF8 */
+    5,   /* \xF9 */
+    5,   /* \xFA */
+    5,   /* \xFB */
+    5,   /* \xFC */
+    5,   /* \xFD */
+    5,   /* \xFE */
+    5,   /* \xFF */
+};
+
+/* Character offsets into glcd_5x7_bitmaps, in bytes */
+const uint16_t glcd_5x7_offsets[] =
+{
+    0,     /* \x00 */
+    7,     /* \x01 */
+    14,    /* \x02 */
+    21,    /* \x03 */
+    28,    /* \x04 */
+    35,    /* \x05 */
+    42,    /* \x06 */
+    49,    /* \x07 */
+    56,    /* \x08 */
+    63,    /* \x09 */
+    70,    /* \x0A */
+    77,    /* \x0B */
+    84,    /* \x0C */
+    91,    /* \x0D */
+    98,    /* \x0E */
+    105,   /* \x0F */
+    112,   /* \x10 */
+    119,   /* \x11 */
+    126,   /* \x12 */
+    133,   /* \x13 */
+    140,   /* \x14 */
+    147,   /* \x15 */
+    154,   /* \x16 */
+    161,   /* \x17 */
+    168,   /* \x18 */
+    175,   /* \x19 */
+    182,   /* \x1A */
+    189,   /* \x1B */
+    196,   /* \x1C */
+    203,   /* \x1D */
+    210,   /* \x1E */
+    217,   /* \x1F */
+    224,   /*      */
+    231,   /*   !  */
+    238,   /*   "  */
+    245,   /*   #  */
+    252,   /*   $  */
+    259,   /*   %  */
+    266,   /*   &  */
+    273,   /*   '  */
+    280,   /*   (  */
+    287,   /*   )  */
+    294,   /*   *  */
+    301,   /*   +  */
+    308,   /*   ,  */
+    315,   /*   -  */
+    322,   /*   .  */
+    329,   /*   /  */
+    336,   /*   0  */
+    343,   /*   1  */
+    350,   /*   2  */
+    357,   /*   3  */
+    364,   /*   4  */
+    371,   /*   5  */
+    378,   /*   6  */
+    385,   /*   7  */
+    392,   /*   8  */
+    399,   /*   9  */
+    406,   /*   :  */
+    413,   /*   ;  */
+    420,   /*   <  */
+    427,   /*   =  */
+    434,   /*   >  */
+    441,   /*   ?  */
+    448,   /*   @  */
+    455,   /*   A  */
+    462,   /*   B  */
+    469,   /*   C  */
+    476,   /*   D  */
+    483,   /*   E  */
+    490,   /*   F  */
+    497,   /*   G  */
+    504,   /*   H  */
+    511,   /*   I  */
+    518,   /*   J  */
+    525,   /*   K  */
+    532,   /*   L  */
+    539,   /*   M  */
+    546,   /*   N  */
+    553,   /*   O  */
+    560,   /*   P  */
+    567,   /*   Q  */
+    574,   /*   R  */
+    581,   /*   S  */
+    588,   /*   T  */
+    595,   /*   U  */
+    602,   /*   V  */
+    609,   /*   W  */
+    616,   /*   X  */
+    623,   /*   Y  */
+    630,   /*   Z  */
+    637,   /*   [  */
+    644,   /*   \  */
+    651,   /*   ]  */
+    658,   /*   ^  */
+    665,   /*   _  */
+    672,   /*   `  */
+    679,   /*   a  */
+    686,   /*   b  */
+    693,   /*   c  */
+    700,   /*   d  */
+    707,   /*   e  */
+    714,   /*   f  */
+    721,   /*   g  */
+    728,   /*   h  */
+    735,   /*   i  */
+    742,   /*   j  */
+    749,   /*   k  */
+    756,   /*   l  */
+    763,   /*   m  */
+    770,   /*   n  */
+    777,   /*   o  */
+    784,   /*   p  */
+    791,   /*   q  */
+    798,   /*   r  */
+    805,   /*   s  */
+    812,   /*   t  */
+    819,   /*   u  */
+    826,   /*   v  */
+    833,   /*   w  */
+    840,   /*   x  */
+    847,   /*   y  */
+    854,   /*   z  */
+    861,   /*   {  */
+    868,   /*   |  */
+    875,   /*   }  */
+    882,   /*   ~  */
+    889,   /* \x7F */
+    896,   /* \x80 */
+    903,   /* \x81 */
+    910,   /* \x82 */
+    917,   /* \x83 */
+    924,   /* \x84 */
+    931,   /* \x85 */
+    938,   /* \x86 */
+    945,   /* \x87 */
+    952,   /* \x88 */
+    959,   /* \x89 */
+    966,   /* \x8A */
+    973,   /* \x8B */
+    980,   /* \x8C */
+    987,   /* \x8D */
+    994,   /* \x8E */
+    1001,  /* \x8F */
+    1008,  /* \x90 */
+    1015,  /* \x91 */
+    1022,  /* \x92 */
+    1029,  /* \x93 */
+    1036,  /* \x94 */
+    1043,  /* \x95 */
+    1050,  /* \x96 */
+    1057,  /* \x97 */
+    1064,  /* \x98 */
+    1071,  /* \x99 */
+    1078,  /* \x9A */
+    1085,  /* \x9B */
+    1092,  /* \x9C */
+    1099,  /* \x9D */
+    1106,  /* \x9E */
+    1113,  /* \x9F */
+    1120,  /* \xA0 */
+    1127,  /* \xA1 */
+    1134,  /* \xA2 */
+    1141,  /* \xA3 */
+    1148,  /* \xA4 */
+    1155,  /* \xA5 */
+    1162,  /* \xA6 */
+    1169,  /* \xA7 */
+    1176,  /* \xA8 */
+    1183,  /* \xA9 */
+    1190,  /* \xAA */
+    1197,  /* \xAB */
+    1204,  /* \xAC */
+    1211,  /* \xAD */
+    1218,  /* \xAE */
+    1225,  /* \xAF */
+    1232,  /* \xB0 */
+    1239,  /* \xB1 */
+    1246,  /* \xB2 */
+    1253,  /* \xB3 */
+    1260,  /* \xB4 */
+    1267,  /* \xB5 */
+    1274,  /* \xB6 */
+    1281,  /* \xB7 */
+    1288,  /* \xB8 */
+    1295,  /* \xB9 */
+    1302,  /* \xBA */
+    1309,  /* \xBB */
+    1316,  /* \xBC */
+    1323,  /* \xBD */
+    1330,  /* \xBE */
+    1337,  /* \xBF */
+    1344,  /* \xC0 */
+    1351,  /* \xC1 */
+    1358,  /* \xC2 */
+    1365,  /* \xC3 */
+    1372,  /* \xC4 */
+    1379,  /* \xC5 */
+    1386,  /* \xC6 */
+    1393,  /* \xC7 */
+    1400,  /* \xC8 */
+    1407,  /* \xC9 */
+    1414,  /* \xCA */
+    1421,  /* \xCB */
+    1428,  /* \xCC */
+    1435,  /* \xCD */
+    1442,  /* \xCE */
+    1449,  /* \xCF */
+    1456,  /* \xD0 */
+    1463,  /* \xD1 */
+    1470,  /* \xD2 */
+    1477,  /* \xD3 */
+    1484,  /* \xD4 */
+    1491,  /* \xD5 */
+    1498,  /* \xD6 */
+    1505,  /* \xD7 */
+    1512,  /* \xD8 */
+    1519,  /* \xD9 */
+    1526,  /* \xDA */
+    1533,  /* \xDB */
+    1540,  /* \xDC */
+    1547,  /* \xDD */
+    1554,  /* \xDE */
+    1561,  /* \xDF */
+    1568,  /* \xE0 */
+    1575,  /* \xE1 */
+    1582,  /* \xE2 */
+    1589,  /* \xE3 */
+    1596,  /* \xE4 */
+    1603,  /* \xE5 */
+    1610,  /* \xE6 */
+    1617,  /* \xE7 */
+    1624,  /* \xE8 */
+    1631,  /* \xE9 */
+    1638,  /* \xEA */
+    1645,  /* \xEB */
+    1652,  /* \xEC */
+    1659,  /* \xED */
+    1666,  /* \xEE */
+    1673,  /* \xEF */
+    1680,  /* \xF0 */
+    1687,  /* \xF1 */
+    1694,  /* \xF2 */
+    1701,  /* \xF3 */
+    1708,  /* \xF4 */
+    1715,  /* \xF5 */
+    1722,  /* \xF6 */
+    1729,  /* \xF7 */
+    1736,  /* \xF8 */
+    1743,  /* \xF9 */
+    1750,  /* \xFA */
+    1757,  /* \xFB */
+    1764,  /* \xFC */
+    1771,  /* \xFD */
+    1778,  /* \xFE */
+    1785,  /* \xFF */
 };
 
 /* Font information for glcd 5x7 */
@@ -2583,7 +2843,10 @@ const font_info_t glcd_5x7_font_info =
     1,   /* C */
     0,   /* Start character */
     255, /* End character */
-    glcd_5x7_descriptors, /* Character descriptor array */
+    NULL, /* Character descriptors, see widths and offsets */
     glcd_5x7_bitmaps,     /* Character bitmap array */
+    FONT_ENCODING_RAW,    /* Bitmap encoding */
+    NULL, 0,              /* Single range, start to end */
+    glcd_5x7_widths, glcd_5x7_offsets, /* Character widths and offsets */
 };
 
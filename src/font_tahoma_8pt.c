@@ -1247,105 +1247,204 @@ const uint8_t tahoma_8pt_bitmaps[] =
     0x00, //
 };
 
-/* Character descriptors for Tahoma 8pt */
-/* { [Char width in bits], [Offset into tahoma_8ptCharBitmaps in bytes] } */
-const font_char_desc_t tahoma_8pt_descriptors[] =
+/* Character widths for Tahoma 8pt, in pixels */
+const uint8_t tahoma_8pt_widths[] =
 {
-    {1, 0},         /*   */
-    {1, 11},        /* ! */
-    {3, 22},        /* " */
-    {7, 33},        /* # */
-    {5, 44},        /* $ */
-    {10, 55},       /* % */
-    {7, 77},        /* & */
-    {1, 88},        /* ' */
-    {3, 99},        /* ( */
-    {3, 110},       /* ) */
-    {5, 121},       /* * */
-    {7, 132},       /* + */
-    {2, 143},       /* , */
-    {3, 154},       /* - */
-    {1, 165},       /* . */
-    {3, 176},       /* / */
-    {5, 187},       /* 0 */
-    {3, 198},       /* 1 */
-    {5, 209},       /* 2 */
-    {5, 220},       /* 3 */
-    {5, 231},       /* 4 */
-    {5, 242},       /* 5 */
-    {5, 253},       /* 6 */
-    {5, 264},       /* 7 */
-    {5, 275},       /* 8 */
-    {5, 286},       /* 9 */
-    {1, 297},       /* : */
-    {2, 308},       /* ; */
-    {6, 319},       /* < */
-    {7, 330},       /* = */
-    {6, 341},       /* > */
-    {4, 352},       /* ? */
-    {9, 363},       /* @ */
-    {6, 385},       /* A */
-    {5, 396},       /* B */
-    {6, 407},       /* C */
-    {6, 418},       /* D */
-    {5, 429},       /* E */
-    {5, 440},       /* F */
-    {6, 451},       /* G */
-    {6, 462},       /* H */
-    {3, 473},       /* I */
-    {4, 484},       /* J */
-    {5, 495},       /* K */
-    {4, 506},       /* L */
-    {7, 517},       /* M */
-    {6, 528},       /* N */
-    {7, 539},       /* O */
-    {5, 550},       /* P */
-    {7, 561},       /* Q */
-    {6, 572},       /* R */
-    {5, 583},       /* S */
-    {5, 594},       /* T */
-    {6, 605},       /* U */
-    {5, 616},       /* V */
-    {9, 627},       /* W */
-    {5, 649},       /* X */
-    {5, 660},       /* Y */
-    {5, 671},       /* Z */
-    {3, 682},       /* [ */
-    {3, 693},       /* \ */
-    {3, 704},       /* ] */
-    {7, 715},       /* ^ */
-    {6, 726},       /* _ */
-    {2, 737},       /* ` */
-    {5, 748},       /* a */
-    {5, 759},       /* b */
-    {4, 770},       /* c */
-    {5, 781},       /* d */
-    {5, 792},       /* e */
-    {3, 803},       /* f */
-    {5, 814},       /* g */
-    {5, 825},       /* h */
-    {1, 836},       /* i */
-    {2, 847},       /* j */
-    {5, 858},       /* k */
-    {1, 869},       /* l */
-    {7, 880},       /* m */
-    {5, 891},       /* n */
-    {5, 902},       /* o */
-    {5, 913},       /* p */
-    {5, 924},       /* q */
-    {3, 935},       /* r */
-    {4, 946},       /* s */
-    {3, 957},       /* t */
-    {5, 968},       /* u */
-    {5, 979},       /* v */
-    {7, 990},       /* w */
-    {5, 1001},      /* x */
-    {5, 1012},      /* y */
-    {4, 1023},      /* z */
-    {4, 1034},      /* { */
-    {1, 1045},      /* | */
-    {4, 1056},      /* } */
-    {7, 1067},      /* ~ */
+    1,   /*   */
+    1,   /* ! */
+    3,   /* " */
+    7,   /* # */
+    5,   /* $ */
+    10,  /* % */
+    7,   /* & */
+    1,   /* ' */
+    3,   /* ( */
+    3,   /* ) */
+    5,   /* * */
+    7,   /* + */
+    2,   /* , */
+    3,   /* - */
+    1,   /* . */
+    3,   /* / */
+    5,   /* 0 */
+    3,   /* 1 */
+    5,   /* 2 */
+    5,   /* 3 */
+    5,   /* 4 */
+    5,   /* 5 */
+    5,   /* 6 */
+    5,   /* 7 */
+    5,   /* 8 */
+    5,   /* 9 */
+    1,   /* : */
+    2,   /* ; */
+    6,   /* < */
+    7,   /* = */
+    6,   /* > */
+    4,   /* ? */
+    9,   /* @ */
+    6,   /* A */
+    5,   /* B */
+    6,   /* C */
+    6,   /* D */
+    5,   /* E */
+    5,   /* F */
+    6,   /* G */
+    6,   /* H */
+    3,   /* I */
+    4,   /* J */
+    5,   /* K */
+    4,   /* L */
+    7,   /* M */
+    6,   /* N */
+    7,   /* O */
+    5,   /* P */
+    7,   /* Q */
+    6,   /* R */
+    5,   /* S */
+    5,   /* T */
+    6,   /* U */
+    5,   /* V */
+    9,   /* W */
+    5,   /* X */
+    5,   /* Y */
+    5,   /* Z */
+    3,   /* [ */
+    3,   /* \ */
+    3,   /* ] */
+    7,   /* ^ */
+    6,   /* _ */
+    2,   /* ` */
+    5,   /* a */
+    5,   /* b */
+    4,   /* c */
+    5,   /* d */
+    5,   /* e */
+    3,   /* f */
+    5,   /* g */
+    5,   /* h */
+    1,   /* i */
+    2,   /* j */
+    5,   /* k */
+    1,   /* l */
+    7,   /* m */
+    5,   /* n */
+    5,   /* o */
+    5,   /* p */
+    5,   /* q */
+    3,   /* r */
+    4,   /* s */
+    3,   /* t */
+    5,   /* u */
+    5,   /* v */
+    7,   /* w */
+    5,   /* x */
+    5,   /* y */
+    4,   /* z */
+    4,   /* { */
+    1,   /* | */
+    4,   /* } */
+    7,   /* ~ */
+};
+
+/* Character offsets into tahoma_8pt_bitmaps, in bytes */
+const uint16_t tahoma_8pt_offsets[] =
+{
+    0,     /*   */
+    11,    /* ! */
+    22,    /* " */
+    33,    /* # */
+    44,    /* $ */
+    55,    /* % */
+    77,    /* & */
+    88,    /* ' */
+    99,    /* ( */
+    110,   /* ) */
+    121,   /* * */
+    132,   /* + */
+    143,   /* , */
+    154,   /* - */
+    165,   /* . */
+    176,   /* / */
+    187,   /* 0 */
+    198,   /* 1 */
+    209,   /* 2 */
+    220,   /* 3 */
+    231,   /* 4 */
+    242,   /* 5 */
+    253,   /* 6 */
+    264,   /* 7 */
+    275,   /* 8 */
+    286,   /* 9 */
+    297,   /* : */
+    308,   /* ; */
+    319,   /* < */
+    330,   /* = */
+    341,   /* > */
+    352,   /* ? */
+    363,   /* @ */
+    385,   /* A */
+    396,   /* B */
+    407,   /* C */
+    418,   /* D */
+    429,   /* E */
+    440,   /* F */
+    451,   /* G */
+    462,   /* H */
+    473,   /* I */
+    484,   /* J */
+    495,   /* K */
+    506,   /* L */
+    517,   /* M */
+    528,   /* N */
+    539,   /* O */
+    550,   /* P */
+    561,   /* Q */
+    572,   /* R */
+    583,   /* S */
+    594,   /* T */
+    605,   /* U */
+    616,   /* V */
+    627,   /* W */
+    649,   /* X */
+    660,   /* Y */
+    671,   /* Z */
+    682,   /* [ */
+    693,   /* \ */
+    704,   /* ] */
+    715,   /* ^ */
+    726,   /* _ */
+    737,   /* ` */
+    748,   /* a */
+    759,   /* b */
+    770,   /* c */
+    781,   /* d */
+    792,   /* e */
+    803,   /* f */
+    814,   /* g */
+    825,   /* h */
+    836,   /* i */
+    847,   /* j */
+    858,   /* k */
+    869,   /* l */
+    880,   /* m */
+    891,   /* n */
+    902,   /* o */
+    913,   /* p */
+    924,   /* q */
+    935,   /* r */
+    946,   /* s */
+    957,   /* t */
+    968,   /* u */
+    979,   /* v */
+    990,   /* w */
+    1001,  /* x */
+    1012,  /* y */
+    1023,  /* z */
+    1034,  /* { */
+    1045,  /* | */
+    1056,  /* } */
+    1067,  /* ~ */
 };
 
 /* Font information for Tahoma 8pt */
@@ -1355,8 +1454,11 @@ const font_info_t tahoma_8pt_font_info =
     1,  /*  C */
     ' ', /*  Start character */
     '~', /*  End character */
-    tahoma_8pt_descriptors, /*  Character descriptor array */
+    NULL, /*  Character descriptors, see widths and offsets */
     tahoma_8pt_bitmaps, /*  Character bitmap array */
+    FONT_ENCODING_RAW, /*  Bitmap encoding */
+    NULL, 0, /*  Single range, start to end */
+    tahoma_8pt_widths, tahoma_8pt_offsets, /*  Character widths and offsets */
 };
 
 
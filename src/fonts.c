@@ -2,13 +2,356 @@
  * oled_fonts.c
  *
  */
+#include <string.h>
+
+#include "common/cs_dbg.h"
+
 #include "fonts.h"
+#include "sh1106_internal.h"
+
+#if SH1106_GLYPH_CACHE_SLOTS < 1
+#error "SH1106_GLYPH_CACHE_SLOTS must be at least 1"
+#endif
 
 extern const font_info_t glcd_5x7_font_info;
 extern const font_info_t tahoma_8pt_font_info;
 
-const font_info_t * fonts[NUM_FONTS] =
+static const font_info_t *s_fonts[SH1106_MAX_FONTS] =
+{
+    [FONT_GLCD_5X7] = &glcd_5x7_font_info,
+    [FONT_TAHOMA_8PT] = &tahoma_8pt_font_info,
+};
+
+// Largest glyph of a compressed font once decoded, in bytes
+static uint32_t _max_decoded_size (const font_info_t *font)
+{
+  uint32_t glyphs = font->char_end - font->char_start + 1, size, max = 0;
+
+  if (font->ranges != NULL) {
+    glyphs = 0;
+    for (uint16_t i = 0; i < font->num_ranges; ++i)
+      if (font->ranges[i].glyph + font->ranges[i].count > glyphs)
+        glyphs = font->ranges[i].glyph + font->ranges[i].count;
+  }
+  for (uint32_t g = 0; g < glyphs; ++g) {
+    size = (font_glyph_width (font, g) + 7) / 8 * font->height;
+    if (size > max)
+      max = size;
+  }
+  return max;
+}
+
+int font_register (const font_info_t *font)
+{
+  int free_id = -1;
+  uint32_t need;
+
+  if (font == NULL)
+    return -1;
+  if (font->encoding != FONT_ENCODING_RAW && (need = _max_decoded_size (font)) > SH1106_GLYPH_CACHE_BYTES) {
+    LOG (LL_ERROR, ("SH1106 font glyphs need %u cache bytes, SH1106_GLYPH_CACHE_BYTES is %u",
+                    (unsigned) need, (unsigned) SH1106_GLYPH_CACHE_BYTES));
+    return -1;
+  }
+
+  for (int i = 0; i < SH1106_MAX_FONTS; ++i) {
+    if (s_fonts[i] == font)
+      return i;
+    if (s_fonts[i] == NULL && free_id < 0)
+      free_id = i;
+  }
+  if (free_id >= 0)
+    s_fonts[free_id] = font;
+  return free_id;
+}
+
+void font_unregister (uint8_t id)
+{
+  if (id >= SH1106_MAX_FONTS || s_fonts[id] == NULL)
+    return;
+
+  font_forget (s_fonts[id]);
+  s_fonts[id] = NULL;
+}
+
+const font_info_t *font_get (uint8_t id)
+{
+  return (id < SH1106_MAX_FONTS) ? s_fonts[id] : NULL;
+}
+
+int32_t font_find_glyph (const font_info_t *font, uint32_t cp)
+{
+  const font_range_t *r;
+  uint16_t lo = 0, hi, mid;
+
+  if (font->ranges == NULL) {
+    if (cp < font->char_start || cp > font->char_end)
+      return -1;
+    return cp - font->char_start;
+  }
+  // last range starting at or before cp
+  hi = font->num_ranges;
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (font->ranges[mid].first <= cp)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == 0)
+    return -1;
+  r = &font->ranges[lo - 1];
+  if (cp - r->first >= r->count)
+    return -1;
+  return r->glyph + (cp - r->first);
+}
+
+int32_t font_lookup_glyph (const font_info_t *font, uint32_t cp)
+{
+  int32_t glyph = font_find_glyph (font, cp);
+
+  if (glyph < 0)
+    glyph = font_find_glyph (font, '?');
+  if (glyph < 0)
+    glyph = font_find_glyph (font, ' ');
+  return glyph;
+}
+
+uint32_t font_utf8_next (const char **str)
+{
+  return font_utf8_next_n (str, NULL);
+}
+
+uint32_t font_utf8_next_n (const char **str, const char *end)
+{
+  static const uint32_t min_cp[4] = { 0, 0x80, 0x800, 0x10000 };
+  const uint8_t *p = (const uint8_t *) *str;
+  uint32_t cp = p[0];
+  uint8_t n, i;
+
+  if (cp < 0x80)
+    n = 0;
+  else if ((cp & 0xe0) == 0xc0)
+    n = 1, cp &= 0x1f;
+  else if ((cp & 0xf0) == 0xe0)
+    n = 2, cp &= 0x0f;
+  else if ((cp & 0xf8) == 0xf0)
+    n = 3, cp &= 0x07;
+  else
+    goto latin1;
+
+  for (i = 1; i <= n; ++i) {
+    if ((end != NULL && (const char *) p + i >= end) || (p[i] & 0xc0) != 0x80)
+      goto latin1;
+    cp = (cp << 6) | (p[i] & 0x3f);
+  }
+  if (cp < min_cp[n] || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff))
+    goto latin1;
+  *str += n + 1;
+  return cp;
+
+latin1:
+  *str += 1;
+  return p[0];
+}
+
+uint32_t font_next_char (const font_info_t *font, const char **str, const char *end)
+{
+  const char *p = *str;
+  uint32_t cp = font_utf8_next_n (str, end);
+
+  // a byte-indexed string whose bytes happen to form a sequence the font
+  // can't draw is taken byte by byte, as it was before UTF-8
+  if (*str - p > 1 && font_find_glyph (font, cp) < 0 && font_find_glyph (font, (uint8_t) *p) >= 0) {
+    *str = p + 1;
+    return (uint8_t) *p;
+  }
+  return cp;
+}
+
+struct glyph_slot
+{
+  const font_info_t *font;
+  uint16_t index;
+  uint8_t bitmap[SH1106_GLYPH_CACHE_BYTES];
+};
+
+static struct glyph_slot *s_glyph_cache;
+
+// Nibble stream of an RLE glyph, high nibble first
+struct nibbles
 {
-    &glcd_5x7_font_info,
-    &tahoma_8pt_font_info
+  const uint8_t *p;
+  uint8_t high;
 };
+
+static inline uint8_t _next_nibble (struct nibbles *n)
+{
+  uint8_t v = n->high ? *n->p >> 4 : *n->p++ & 0x0f;
+
+  n->high = !n->high;
+  return v;
+}
+
+uint32_t font_rle_size (const uint8_t *src, uint32_t avail, uint32_t pixels)
+{
+  uint32_t nibbles = 0, n = 0, run;
+
+  // same walk as the decoder, counting nibbles instead of placing pixels
+  while (n < pixels) {
+    if (nibbles >= avail * 2)
+      return 0;
+    run = (src[nibbles / 2] >> ((nibbles & 1) ? 0 : 4)) & 0x0f;
+    ++nibbles;
+    if (run == 15) {
+      if (nibbles + 2 > avail * 2)
+        return 0;
+      run = (src[nibbles / 2] >> ((nibbles & 1) ? 0 : 4)) & 0x0f;
+      run = (run << 4) + 15 + ((src[(nibbles + 1) / 2] >> (((nibbles + 1) & 1) ? 0 : 4)) & 0x0f);
+      nibbles += 2;
+    }
+    n += run;
+  }
+  return (nibbles + 1) / 2;
+}
+
+static void _decode_glyph (const font_info_t *font, uint16_t index, uint8_t *out)
+{
+  const uint8_t *src = font->bitmap + font_glyph_offset (font, index);
+  uint8_t width = font_glyph_width (font, index);
+  uint8_t stride = (width + 7) / 8;
+  uint32_t total = (uint32_t) width * font->height, n = 0, run;
+  struct nibbles nib = { src, 1 };
+  uint8_t on = 0, col;
+
+  memset (out, 0, stride * font->height);
+  if (font->encoding == FONT_ENCODING_PACKED) {
+    for (n = 0; n < total; ++n)
+      if (src[n >> 3] & (0x80 >> (n & 7))) {
+        col = n % width;
+        out[n / width * stride + col / 8] |= 0x80 >> (col & 7);
+      }
+    return;
+  }
+  // RLE: runs alternate off/on starting with off; 15 escapes an 8-bit extra length
+  while (n < total) {
+    run = _next_nibble (&nib);
+    if (run == 15) {
+      run = _next_nibble (&nib) << 4;
+      run += 15 + _next_nibble (&nib);
+    }
+    if (run > total - n)
+      run = total - n;
+    for (; on && run; --run, ++n) {
+      col = n % width;
+      out[n / width * stride + col / 8] |= 0x80 >> (col & 7);
+    }
+    n += run;
+    on = !on;
+  }
+}
+
+const uint8_t *font_get_glyph (const font_info_t *font, uint16_t index)
+{
+  struct glyph_slot *slot;
+
+  if (font->encoding == FONT_ENCODING_RAW)
+    return font->bitmap + font_glyph_offset (font, index);
+
+  if ((font_glyph_width (font, index) + 7) / 8 * font->height > SH1106_GLYPH_CACHE_BYTES)
+    return NULL;
+  if (s_glyph_cache == NULL) {
+    s_glyph_cache = sh1106_alloc (SH1106_GLYPH_CACHE_SLOTS * sizeof (*s_glyph_cache));
+    if (s_glyph_cache == NULL)
+      return NULL;
+  }
+  // direct mapped on the glyph index
+  slot = &s_glyph_cache[index % SH1106_GLYPH_CACHE_SLOTS];
+  if (slot->font != font || slot->index != index) {
+    _decode_glyph (font, index, slot->bitmap);
+    slot->font = font;
+    slot->index = index;
+  }
+  return slot->bitmap;
+}
+
+#if SH1106_WIDTH_CACHE_SLOTS
+struct width_slot
+{
+  const font_info_t *font;
+  uint32_t hash;
+  uint16_t len;
+  uint16_t width;
+  char text[SH1106_WIDTH_CACHE_LEN];    // the string measured, a hit must match it
+};
+
+static struct width_slot s_width_cache[SH1106_WIDTH_CACHE_SLOTS];
+#endif
+
+uint16_t font_measure (const font_info_t *font, const char *str, size_t len)
+{
+  const char *p = str, *end;
+  uint16_t w = 0;
+  int32_t glyph;
+#if SH1106_WIDTH_CACHE_SLOTS
+  struct width_slot *slot;
+  uint32_t h = 2166136261u;
+  size_t n;
+
+  if (font == NULL || str == NULL)
+    return 0;
+
+  // FNV-1a over the bytes; this also finds the end of the string
+  for (n = 0; n < len && str[n]; ++n)
+    h = (h ^ (uint8_t) str[n]) * 16777619u;
+  end = str + n;
+  slot = &s_width_cache[h % SH1106_WIDTH_CACHE_SLOTS];
+  if (n > sizeof (slot->text))
+    slot = NULL;                // too long to keep
+  else if (slot->font == font && slot->hash == h && slot->len == n && memcmp (slot->text, str, n) == 0)
+    return slot->width;
+#else
+  if (font == NULL || str == NULL)
+    return 0;
+
+  if (len == SIZE_MAX)
+    end = str + strlen (str);
+  else if ((end = memchr (str, '\0', len)) == NULL)
+    end = str + len;
+#endif
+
+  while (p < end) {
+    glyph = font_lookup_glyph (font, font_next_char (font, &p, end));
+    if (glyph >= 0)
+      w += font_glyph_width (font, glyph);
+    if (p < end)
+      w += font->c;
+  }
+
+#if SH1106_WIDTH_CACHE_SLOTS
+  if (slot != NULL) {
+    slot->font = font;
+    slot->hash = h;
+    slot->len = n;
+    slot->width = w;
+    memcpy (slot->text, str, n);
+  }
+#endif
+  return w;
+}
+
+void font_forget (const font_info_t *font)
+{
+#if SH1106_WIDTH_CACHE_SLOTS
+  for (uint8_t i = 0; i < SH1106_WIDTH_CACHE_SLOTS; ++i)
+    if (s_width_cache[i].font == font)
+      s_width_cache[i].font = NULL;
+#endif
+
+  if (s_glyph_cache == NULL)
+    return;
+
+  for (uint8_t i = 0; i < SH1106_GLYPH_CACHE_SLOTS; ++i)
+    if (s_glyph_cache[i].font == font)
+      s_glyph_cache[i].font = NULL;
+}
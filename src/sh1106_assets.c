@@ -0,0 +1,353 @@
+/*
+ * Asset packs: fonts and images used in place from a memory mapping.
+ *
+ * Layout, little endian, sections 4-byte aligned:
+ *
+ *   header   "SHAP", u16 version, u16 entry count, u32 pack size,
+ *            u32 FNV-1a hash of the entry table
+ *   entries  32 bytes each: name[16] (NUL padded), u8 type, u8 a, u8 b,
+ *            u8 c, u16 p, u16 q, u32 offset, u32 size
+ *   data
+ *
+ * Fonts (type 1): a = encoding, b = height, c = spacing, p..q = character
+ * range; offset points at the font_char_desc_t table (u8 width, pad,
+ * u16 offset) followed, 4-byte aligned, by the bitmap. Packed images
+ * (type 2) hold mgos_sh1106_draw_packed() data; bitmaps (type 3) are raw
+ * page-format images of p x q pixels.
+ *
+ * tools/sh1106_assets.py builds packs.
+ */
+#include <string.h>
+#include <stddef.h>
+
+#include "common/cs_dbg.h"
+
+#include "sh1106.h"
+#include "sh1106_internal.h"
+
+#if defined(ESP_PLATFORM)
+#include "esp_partition.h"
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SH1106_ASSETS_MMAP 1
+#endif
+
+#define ASSETS_MAGIC "SHAP"
+#define ASSETS_VERSION 1
+#define ASSETS_HEADER_SIZE 16
+#define ASSETS_ENTRY_SIZE 32
+#define ASSETS_NAME_LEN 16
+
+enum sh1106_asset_type
+{
+  ASSET_FONT = 1,
+  ASSET_PACKED = 2,
+  ASSET_BITMAP = 3,
+};
+
+// Descriptors are used in place, so the pack stores them in this exact layout
+_Static_assert (sizeof (font_char_desc_t) == 4 && offsetof (font_char_desc_t, offset) == 2,
+                "font_char_desc_t layout differs from the asset pack descriptors");
+
+struct mgos_sh1106_assets
+{
+  const uint8_t *base;
+  size_t size;
+  uint16_t count;
+  font_info_t *fonts;           // per entry, filled for fonts once checked
+  uint8_t *font_state;          // per entry: 0 unchecked, 1 valid, 2 invalid
+#if defined(ESP_PLATFORM)
+  spi_flash_mmap_handle_t handle;
+#endif
+  size_t map_len;               // mmap()ed length, 0 if not owned
+};
+
+static inline uint16_t _le16 (const uint8_t *p)
+{
+  return p[0] | p[1] << 8;
+}
+
+static inline uint32_t _le32 (const uint8_t *p)
+{
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static inline const uint8_t *_entry (const struct mgos_sh1106_assets *a, uint16_t i)
+{
+  return a->base + ASSETS_HEADER_SIZE + i * ASSETS_ENTRY_SIZE;
+}
+
+static uint32_t _fnv1a (const uint8_t *p, size_t len)
+{
+  uint32_t h = 2166136261u;
+
+  while (len--)
+    h = (h ^ *p++) * 16777619u;
+  return h;
+}
+
+// Check the header and that every entry lies inside the pack
+static bool _validate (struct mgos_sh1106_assets *a)
+{
+  const uint8_t *e;
+  uint32_t off, size;
+
+  if (a->size < ASSETS_HEADER_SIZE || memcmp (a->base, ASSETS_MAGIC, 4) != 0 || _le16 (a->base + 4) != ASSETS_VERSION)
+    return false;
+  a->count = _le16 (a->base + 6);
+  if (_le32 (a->base + 8) > a->size)
+    return false;
+  a->size = _le32 (a->base + 8);
+  if (ASSETS_HEADER_SIZE + (size_t) a->count * ASSETS_ENTRY_SIZE > a->size)
+    return false;
+  if (_fnv1a (_entry (a, 0), (size_t) a->count * ASSETS_ENTRY_SIZE) != _le32 (a->base + 12))
+    return false;
+
+  for (uint16_t i = 0; i < a->count; ++i) {
+    e = _entry (a, i);
+    off = _le32 (e + 24);
+    size = _le32 (e + 28);
+    if ((off & 3) || off > a->size || size > a->size - off || e[ASSETS_NAME_LEN - 1] != '\0')
+      return false;
+  }
+  return true;
+}
+
+static struct mgos_sh1106_assets *_open (const void *data, size_t len)
+{
+  struct mgos_sh1106_assets *a = sh1106_alloc (sizeof (*a));
+
+  if (a == NULL)
+    return NULL;
+  a->base = (const uint8_t *) data;
+  a->size = len;
+  if (!_validate (a)) {
+    LOG (LL_ERROR, ("SH1106 asset pack invalid"));
+    sh1106_release (a);
+    return NULL;
+  }
+  a->fonts = sh1106_alloc (a->count * (sizeof (*a->fonts) + 1));
+  if (a->count && a->fonts == NULL) {
+    sh1106_release (a);
+    return NULL;
+  }
+  a->font_state = (uint8_t *) (a->fonts + a->count);
+  LOG (LL_INFO, ("SH1106 asset pack: %u entries, %u bytes", a->count, (unsigned) a->size));
+  return a;
+}
+
+struct mgos_sh1106_assets *mgos_sh1106_assets_open_memory (const void *data, size_t len)
+{
+  if (data == NULL)
+    return NULL;
+
+  return _open (data, len);
+}
+
+struct mgos_sh1106_assets *mgos_sh1106_assets_open_partition (const char *label)
+{
+#if defined(ESP_PLATFORM)
+  const esp_partition_t *part;
+  spi_flash_mmap_handle_t handle;
+  struct mgos_sh1106_assets *a;
+  const void *ptr;
+
+  part = esp_partition_find_first (ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+  if (part == NULL) {
+    LOG (LL_ERROR, ("SH1106 asset partition %s not found", label));
+    return NULL;
+  }
+  if (esp_partition_mmap (part, 0, part->size, SPI_FLASH_MMAP_DATA, &ptr, &handle) != ESP_OK) {
+    LOG (LL_ERROR, ("SH1106 asset partition %s mmap failed", label));
+    return NULL;
+  }
+  a = _open (ptr, part->size);
+  if (a == NULL) {
+    spi_flash_munmap (handle);
+    return NULL;
+  }
+  a->handle = handle;
+  return a;
+#else
+  LOG (LL_ERROR, ("SH1106 asset partitions are not supported on this platform"));
+  (void) label;
+  return NULL;
+#endif
+}
+
+struct mgos_sh1106_assets *mgos_sh1106_assets_open_file (const char *path)
+{
+#if SH1106_ASSETS_MMAP
+  struct mgos_sh1106_assets *a;
+  struct stat st;
+  void *ptr;
+  int fd;
+
+  fd = open (path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  if (fstat (fd, &st) != 0 || st.st_size == 0) {
+    close (fd);
+    return NULL;
+  }
+  ptr = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (ptr == MAP_FAILED)
+    return NULL;
+  a = _open (ptr, st.st_size);
+  if (a == NULL) {
+    munmap (ptr, st.st_size);
+    return NULL;
+  }
+  a->map_len = st.st_size;
+  return a;
+#else
+  LOG (LL_ERROR, ("SH1106 asset files are not supported on this platform"));
+  (void) path;
+  return NULL;
+#endif
+}
+
+void mgos_sh1106_assets_close (struct mgos_sh1106_assets *assets)
+{
+  if (assets == NULL)
+    return;
+
+#if defined(ESP_PLATFORM)
+  if (assets->handle)
+    spi_flash_munmap (assets->handle);
+#elif SH1106_ASSETS_MMAP
+  if (assets->map_len)
+    munmap ((void *) assets->base, assets->map_len);
+#endif
+  for (uint16_t i = 0; i < assets->count; ++i)
+    if (assets->font_state[i] == 1)
+      font_forget (&assets->fonts[i]);
+  sh1106_release (assets->fonts);
+  sh1106_release (assets);
+}
+
+static int32_t _find (const struct mgos_sh1106_assets *a, const char *name, enum sh1106_asset_type type)
+{
+  const uint8_t *e;
+
+  if (a == NULL || name == NULL)
+    return -1;
+
+  for (uint16_t i = 0; i < a->count; ++i) {
+    e = _entry (a, i);
+    if (e[16] == type && strncmp ((const char *) e, name, ASSETS_NAME_LEN) == 0)
+      return i;
+  }
+  return -1;
+}
+
+const font_info_t *mgos_sh1106_assets_font (struct mgos_sh1106_assets *assets, const char *name)
+{
+  int32_t i = _find (assets, name, ASSET_FONT);
+  const uint8_t *e;
+  const font_char_desc_t *desc;
+  uint32_t off, size, glyphs, bitmap, bits, pixels, need;
+  font_info_t *f;
+
+  if (i < 0)
+    return NULL;
+  if (assets->font_state[i])
+    return (assets->font_state[i] == 1) ? &assets->fonts[i] : NULL;
+
+  // first use: check the descriptors against the bitmap they index
+  e = _entry (assets, i);
+  off = _le32 (e + 24);
+  size = _le32 (e + 28);
+  glyphs = (_le16 (e + 22) >= _le16 (e + 20)) ? _le16 (e + 22) - _le16 (e + 20) + 1 : 0;
+  bitmap = (glyphs * sizeof (font_char_desc_t) + 3) & ~3;
+  assets->font_state[i] = 2;
+  if (glyphs == 0 || bitmap > size || e[17] > FONT_ENCODING_RLE)
+    return NULL;
+  bits = size - bitmap;
+  desc = (const font_char_desc_t *) (assets->base + off);
+  for (uint32_t g = 0; g < glyphs; ++g) {
+    if (desc[g].offset > bits)
+      return NULL;
+    // compressed glyphs are drawn from the decode cache, so they must fit it
+    if (e[17] != FONT_ENCODING_RAW && (desc[g].width + 7) / 8 * e[18] > SH1106_GLYPH_CACHE_BYTES)
+      return NULL;
+    pixels = (uint32_t) desc[g].width * e[18];
+    if (e[17] == FONT_ENCODING_RAW) {
+      need = (desc[g].width + 7) / 8 * e[18];
+    } else if (e[17] == FONT_ENCODING_PACKED) {
+      need = (pixels + 7) / 8;
+    } else {
+      // RLE glyphs have no fixed length: walk the runs up to the end of the bitmap
+      need = font_rle_size (assets->base + off + bitmap + desc[g].offset, bits - desc[g].offset, pixels);
+      if (need == 0 && pixels)
+        return NULL;
+    }
+    if (desc[g].offset + need > bits)
+      return NULL;
+  }
+
+  f = &assets->fonts[i];
+  f->encoding = e[17];
+  f->height = e[18];
+  f->c = e[19];
+  f->char_start = _le16 (e + 20);
+  f->char_end = _le16 (e + 22);
+  f->char_descriptors = desc;
+  f->bitmap = assets->base + off + bitmap;
+  assets->font_state[i] = 1;
+  return f;
+}
+
+bool mgos_sh1106_assets_draw (struct mgos_sh1106 *oled, struct mgos_sh1106_assets *assets, const char *name,
+                              int16_t x, int16_t y, mgos_sh1106_rop_t rop)
+{
+  struct mgos_sh1106_surface src;
+  const uint8_t *e;
+  int32_t i;
+
+  if (oled == NULL)
+    return false;
+
+  i = _find (assets, name, ASSET_PACKED);
+  if (i >= 0) {
+    e = _entry (assets, i);
+    return mgos_sh1106_draw_packed (oled, x, y, assets->base + _le32 (e + 24), _le32 (e + 28), rop);
+  }
+  i = _find (assets, name, ASSET_BITMAP);
+  if (i < 0)
+    return false;
+  e = _entry (assets, i);
+  memset (&src, 0, sizeof (src));
+  src.buffer = (uint8_t *) (assets->base + _le32 (e + 24));
+  src.width = _le16 (e + 20);
+  src.height = _le16 (e + 22);
+  if ((size_t) src.width * (src.height / 8) > _le32 (e + 28) || (src.height & 7))
+    return false;
+  mgos_sh1106_blit (oled, &src, 0, 0, src.width, src.height, x, y, rop);
+  return true;
+}
+
+bool mgos_sh1106_assets_get_image_size (struct mgos_sh1106_assets *assets, const char *name, uint16_t *width, uint16_t *height)
+{
+  const uint8_t *e;
+  int32_t i;
+
+  i = _find (assets, name, ASSET_PACKED);
+  if (i >= 0) {
+    e = _entry (assets, i);
+    return mgos_sh1106_packed_get_size (assets->base + _le32 (e + 24), _le32 (e + 28), width, height);
+  }
+  i = _find (assets, name, ASSET_BITMAP);
+  if (i < 0)
+    return false;
+  e = _entry (assets, i);
+  if (width != NULL)
+    *width = _le16 (e + 20);
+  if (height != NULL)
+    *height = _le16 (e + 22);
+  return true;
+}
@@ -0,0 +1,227 @@
+/*
+ * Strip charts: a plot that scrolls left one column per decimated group of
+ * samples. Each column is the min/max envelope of its samples. New columns
+ * shift the plot in place, a page-row memmove per page, and are drawn as a
+ * single masked byte per page.
+ */
+#include <string.h>
+
+#include "common/cs_dbg.h"
+
+#include "sh1106.h"
+#include "sh1106_internal.h"
+
+struct mgos_sh1106_chart
+{
+  int16_t x;                    // plot area
+  int16_t y;
+  uint16_t width;
+  uint16_t height;
+  int32_t lo;                   // value shown on the bottom row
+  int32_t hi;                   // and on the top row
+  uint16_t per_column;          // samples decimated into one column
+  uint16_t count;               // samples in the open column
+  int32_t acc_min;              // envelope of the open column
+  int32_t acc_max;
+  int32_t last;                 // last sample, joins adjacent columns
+  uint16_t head;                // ring slot of the newest column
+  uint16_t columns;             // columns filled, up to width
+  uint16_t pending;             // columns not drawn yet
+  mgos_sh1106_color_t foreground;
+  mgos_sh1106_color_t background;
+  int32_t *col_min;             // ring of column envelopes, width each
+  int32_t *col_max;
+};
+
+// Plot rows top..bottom that fall in page p
+static inline uint8_t _page_mask (int32_t p, int32_t top, int32_t bottom)
+{
+  int32_t first = (top > p * 8) ? top : p * 8;
+  int32_t last = (bottom < p * 8 + 7) ? bottom : p * 8 + 7;
+
+  if (first > last)
+    return 0;
+  return (0xff << (first & 7)) & (0xff >> (7 - (last & 7)));
+}
+
+static int32_t _value_row (const struct mgos_sh1106_chart *c, int32_t v)
+{
+  int64_t r;
+
+  if (v <= c->lo)
+    return c->y + c->height - 1;
+  if (v >= c->hi)
+    return c->y;
+  r = ((int64_t) v - c->lo) * (c->height - 1) / ((int64_t) c->hi - c->lo);
+  return c->y + c->height - 1 - (int32_t) r;
+}
+
+// Paint one plot column: the envelope rows in the foreground, the rest of
+// the plot in the background, a byte per page
+static void _draw_column (struct mgos_sh1106_surface *s, const struct mgos_sh1106_chart *c, int32_t col, bool filled,
+                          int32_t vmin, int32_t vmax)
+{
+  int32_t top = c->y, bottom = c->y + c->height - 1;
+  int32_t line_top = filled ? _value_row (c, vmax) : INT32_MAX;
+  int32_t line_bottom = filled ? _value_row (c, vmin) : INT32_MIN;
+  uint8_t plot, line;
+  size_t index;
+
+  for (int32_t p = top / 8; p <= bottom / 8; ++p) {
+    plot = _page_mask (p, top, bottom);
+    line = _page_mask (p, line_top, line_bottom);
+    index = p * s->width + col;
+    _paint_bits (s, index, plot & ~line, c->background);
+    if (line)
+      _paint_bits (s, index, line, c->foreground);
+  }
+}
+
+// Move the plot left by shift columns, in every plane
+static void _shift_plot (struct mgos_sh1106_surface *s, const struct mgos_sh1106_chart *c, uint16_t shift)
+{
+  int32_t top = c->y, bottom = c->y + c->height - 1;
+  uint16_t keep = c->width - shift;
+  uint8_t *planes[2] = { s->buffer, s->gray };
+  uint8_t mask, *row;
+
+  for (uint8_t k = 0; k < 2 && planes[k] != NULL; ++k) {
+    for (int32_t p = top / 8; p <= bottom / 8; ++p) {
+      mask = _page_mask (p, top, bottom);
+      row = planes[k] + p * s->width + c->x;
+      if (mask == 0xff) {
+        memmove (row, row + shift, keep);
+      } else {
+        for (uint16_t i = 0; i < keep; ++i)
+          row[i] = (row[i] & ~mask) | (row[i + shift] & mask);
+      }
+    }
+  }
+}
+
+// The plot must lie inside the target surface
+static struct mgos_sh1106_surface *_plot_surface (struct mgos_sh1106 *oled, const struct mgos_sh1106_chart *c)
+{
+  struct mgos_sh1106_surface *s = oled->target;
+
+  if (c->x < 0 || c->y < 0 || c->x + c->width > s->width || c->y + c->height > s->height)
+    return NULL;
+  return s;
+}
+
+bool mgos_sh1106_chart_redraw (struct mgos_sh1106 *oled, struct mgos_sh1106_chart *chart)
+{
+  struct mgos_sh1106_surface *s;
+  uint16_t slot;
+
+  if (oled == NULL || chart == NULL || (s = _plot_surface (oled, chart)) == NULL)
+    return false;
+
+  // newest column on the right
+  for (uint16_t i = 0; i < chart->width; ++i) {
+    slot = (chart->head + 1 + i) % chart->width;
+    _draw_column (s, chart, chart->x + i, i >= chart->width - chart->columns, chart->col_min[slot], chart->col_max[slot]);
+  }
+  chart->pending = 0;
+  _mark_dirty (s, chart->x, chart->y, chart->x + chart->width - 1, chart->y + chart->height - 1);
+  return true;
+}
+
+struct mgos_sh1106_chart *mgos_sh1106_chart_create (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint16_t width,
+                                                    uint16_t height, int32_t lo, int32_t hi, uint16_t per_column,
+                                                    mgos_sh1106_color_t foreground, mgos_sh1106_color_t background)
+{
+  struct mgos_sh1106_chart *c;
+
+  if (oled == NULL || width == 0 || height == 0 || lo >= hi)
+    return NULL;
+
+  c = sh1106_alloc (sizeof (*c) + 2 * width * sizeof (int32_t));
+  if (c == NULL) {
+    LOG (LL_ERROR, ("SH1106 chart %ux%u allocation failed", width, height));
+    return NULL;
+  }
+  c->x = x;
+  c->y = y;
+  c->width = width;
+  c->height = height;
+  c->lo = lo;
+  c->hi = hi;
+  c->per_column = per_column ? per_column : 1;
+  c->foreground = foreground;
+  c->background = (background == SH1106_COLOR_TRANSPARENT) ? SH1106_COLOR_BLACK : background;
+  c->col_min = (int32_t *) (c + 1);
+  c->col_max = c->col_min + width;
+  if (_plot_surface (oled, c) == NULL) {
+    LOG (LL_ERROR, ("SH1106 chart does not fit the target"));
+    sh1106_release (c);
+    return NULL;
+  }
+  mgos_sh1106_chart_redraw (oled, c);
+  return c;
+}
+
+void mgos_sh1106_chart_free (struct mgos_sh1106_chart *chart)
+{
+  sh1106_release (chart);
+}
+
+bool mgos_sh1106_chart_set_range (struct mgos_sh1106 *oled, struct mgos_sh1106_chart *chart, int32_t lo, int32_t hi)
+{
+  if (chart == NULL || lo >= hi)
+    return false;
+
+  chart->lo = lo;
+  chart->hi = hi;
+  return mgos_sh1106_chart_redraw (oled, chart);
+}
+
+bool mgos_sh1106_chart_add (struct mgos_sh1106 *oled, struct mgos_sh1106_chart *chart, const int32_t *samples, size_t count)
+{
+  struct mgos_sh1106_surface *s;
+  uint16_t shift, slot;
+  int32_t v;
+
+  if (oled == NULL || chart == NULL || samples == NULL)
+    return false;
+
+  for (size_t i = 0; i < count; ++i) {
+    v = samples[i];
+    if (chart->count == 0) {
+      // start from the previous sample so the trace has no gaps
+      chart->acc_min = chart->acc_max = chart->columns ? chart->last : v;
+    }
+    if (v < chart->acc_min)
+      chart->acc_min = v;
+    if (v > chart->acc_max)
+      chart->acc_max = v;
+    chart->last = v;
+    if (++chart->count < chart->per_column)
+      continue;
+    chart->count = 0;
+    chart->head = (chart->head + 1) % chart->width;
+    chart->col_min[chart->head] = chart->acc_min;
+    chart->col_max[chart->head] = chart->acc_max;
+    if (chart->columns < chart->width)
+      ++chart->columns;
+    if (chart->pending < chart->width)
+      ++chart->pending;
+  }
+
+  if (chart->pending == 0)
+    return true;
+  if ((s = _plot_surface (oled, chart)) == NULL)
+    return false;
+
+  // one shift for all new columns, then draw just those
+  shift = chart->pending;
+  if (shift < chart->width)
+    _shift_plot (s, chart, shift);
+  for (uint16_t i = 0; i < shift; ++i) {
+    slot = (chart->head + chart->width - (shift - 1 - i)) % chart->width;
+    _draw_column (s, chart, chart->x + chart->width - shift + i, true, chart->col_min[slot], chart->col_max[slot]);
+  }
+  chart->pending = 0;
+  _mark_dirty (s, chart->x, chart->y, chart->x + chart->width - 1, chart->y + chart->height - 1);
+  return true;
+}
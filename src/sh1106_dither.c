@@ -0,0 +1,253 @@
+/*
+ * Grayscale image dithering into page-format surfaces.
+ *
+ * Image rows are dithered into a band holding one destination page (8 rows)
+ * and merged into the surface a page at a time, so memory use is a band and,
+ * for error diffusion, two rows of error terms, whatever the image height.
+ */
+#include <string.h>
+
+#include "common/cs_dbg.h"
+
+#include "sh1106.h"
+#include "sh1106_internal.h"
+
+struct mgos_sh1106_gray_stream
+{
+  struct mgos_sh1106_surface *s;        // target when the stream began
+  int16_t x;                    // destination of the image's top-left pixel
+  int16_t y;
+  uint16_t width;
+  uint16_t height;
+  uint16_t row;                 // next image row
+  mgos_sh1106_dither_t dither;
+  uint8_t levels;               // 2, or 4 on a canvas in gray mode
+  uint8_t band_rows;            // rows of band_page present in the band
+  int32_t band_page;            // destination page the band holds
+  int16_t *err;                 // error terms x16 of the current row, width + 2
+  int16_t *err_next;            // and of the next one
+  uint8_t *band;                // canvas plane bits, width bytes
+  uint8_t *band_gray;           // gray plane bits, 4 levels only
+};
+
+static const uint8_t s_bayer8[8][8] = {
+  {0, 32, 8, 40, 2, 34, 10, 42},
+  {48, 16, 56, 24, 50, 18, 58, 26},
+  {12, 44, 4, 36, 14, 46, 6, 38},
+  {60, 28, 52, 20, 62, 30, 54, 22},
+  {3, 35, 11, 43, 1, 33, 9, 41},
+  {51, 19, 59, 27, 49, 17, 57, 25},
+  {15, 47, 7, 39, 13, 45, 5, 37},
+  {63, 31, 55, 23, 61, 29, 53, 21},
+};
+
+#if defined(__GNUC__) && (defined(__SSE2__) || defined(__ARM_NEON))
+#define SH1106_DITHER_VECTOR 1
+typedef uint8_t v16u8 __attribute__ ((vector_size (16)));
+#endif
+
+// Merge the band into its destination page
+static void _flush_band (struct mgos_sh1106_gray_stream *st)
+{
+  struct mgos_sh1106_surface *s = st->s;
+  uint8_t mask = st->band_rows;
+  int32_t first, last, top;
+  uint8_t *dst, *gray;
+
+  if (mask == 0)
+    return;
+
+  first = (st->x < 0) ? -st->x : 0;
+  last = (st->x + st->width > s->width) ? s->width - st->x : st->width;
+  if (st->band_page >= 0 && st->band_page < s->height / 8 && first < last) {
+    dst = s->buffer + st->band_page * s->width + st->x;
+    for (int32_t i = first; i < last; ++i)
+      dst[i] = (dst[i] & ~mask) | (st->band[i] & mask);
+    if (s->gray != NULL) {
+      // mono pixels clear their gray bits
+      gray = s->gray + st->band_page * s->width + st->x;
+      for (int32_t i = first; i < last; ++i)
+        gray[i] = (gray[i] & ~mask) | ((st->band_gray != NULL ? st->band_gray[i] : 0) & mask);
+    }
+    top = st->band_page * 8;
+    _mark_dirty (s, st->x + first, top, st->x + last - 1, top + 7);
+  }
+  memset (st->band, 0, st->width);
+  if (st->band_gray != NULL)
+    memset (st->band_gray, 0, st->width);
+  st->band_rows = 0;
+}
+
+// Level q of levels into the band's planes: 4-level pairs (canvas, gray)
+// are 0 = (0,0), 1 = (0,1), 2 = (1,1), 3 = (1,0), see the gray mode tick
+static inline void _put_level (struct mgos_sh1106_gray_stream *st, uint16_t i, uint8_t q, uint8_t bit)
+{
+  if (st->levels == 2) {
+    if (q)
+      st->band[i] |= bit;
+    return;
+  }
+  if (q >= 2)
+    st->band[i] |= bit;
+  if (q == 1 || q == 2)
+    st->band_gray[i] |= bit;
+}
+
+// Two-level ordered dither of one row: a pixel is lit when it reaches its
+// threshold, thr repeating every 8 columns
+static void _bayer_row_mono (uint8_t *band, const uint8_t *px, uint16_t width, const uint8_t thr[16], uint8_t bit)
+{
+  uint16_t i = 0;
+
+#if SH1106_DITHER_VECTOR
+  v16u8 t, b, v, m;
+
+  memcpy (&t, thr, sizeof (t));
+  memset (&b, bit, sizeof (b));
+  for (; i + 16 <= width; i += 16) {
+    memcpy (&v, px + i, sizeof (v));
+    memcpy (&m, band + i, sizeof (m));
+    m |= (v16u8) (v >= t) & b;
+    memcpy (band + i, &m, sizeof (m));
+  }
+#endif
+  for (; i < width; ++i)
+    if (px[i] >= thr[i & 15])
+      band[i] |= bit;
+}
+
+static void _bayer_row (struct mgos_sh1106_gray_stream *st, const uint8_t *px, int32_t dy, uint8_t bit)
+{
+  const uint8_t *m = s_bayer8[dy & 7];
+  uint8_t thr[16];
+  uint16_t q;
+
+  if (st->levels == 2) {
+    // lit when v + 4 * m + 2 >= 255
+    for (uint8_t k = 0; k < 16; ++k)
+      thr[k] = 253 - 4 * m[(st->x + k) & 7];
+    _bayer_row_mono (st->band, px, st->width, thr, bit);
+    return;
+  }
+  for (uint16_t i = 0; i < st->width; ++i) {
+    q = (px[i] * (st->levels - 1) + 4 * m[(st->x + i) & 7] + 2) / 255;
+    _put_level (st, i, q, bit);
+  }
+}
+
+// Floyd-Steinberg, left to right, errors kept x16
+static void _diffuse_row (struct mgos_sh1106_gray_stream *st, const uint8_t *px, uint8_t bit)
+{
+  int16_t *cur = st->err, *next = st->err_next;
+  uint8_t top = st->levels - 1;
+  int16_t v, e;
+  uint8_t q;
+
+  for (uint16_t i = 0; i < st->width; ++i) {
+    v = px[i] + cur[i + 1] / 16;
+    if (v < 0)
+      v = 0;
+    else if (v > 255)
+      v = 255;
+    q = (v * top + 127) / 255;
+    _put_level (st, i, q, bit);
+    e = v - q * 255 / top;
+    cur[i + 2] += 7 * e;
+    next[i] += 3 * e;
+    next[i + 1] += 5 * e;
+    next[i + 2] += e;
+  }
+  st->err = next;
+  st->err_next = cur;
+  memset (cur, 0, (st->width + 2) * sizeof (*cur));
+}
+
+struct mgos_sh1106_gray_stream *mgos_sh1106_gray_stream_begin (struct mgos_sh1106 *oled, int16_t x, int16_t y,
+                                                              uint16_t width, uint16_t height, mgos_sh1106_dither_t dither)
+{
+  struct mgos_sh1106_gray_stream *st;
+  bool gray, diffuse;
+  size_t size;
+
+  if (oled == NULL || width == 0 || height == 0)
+    return NULL;
+
+  gray = oled->target->gray != NULL;
+  diffuse = dither == SH1106_DITHER_FLOYD_STEINBERG;
+  // one block: state, error rows, bands
+  size = sizeof (*st) + (diffuse ? 2 * (width + 2) * sizeof (int16_t) : 0) + (gray ? 2 : 1) * (size_t) width;
+  st = sh1106_alloc (size);
+  if (st == NULL) {
+    LOG (LL_ERROR, ("SH1106 gray image %ux%u allocation failed", width, height));
+    return NULL;
+  }
+  st->s = oled->target;
+  st->x = x;
+  st->y = y;
+  st->width = width;
+  st->height = height;
+  st->dither = dither;
+  st->levels = gray ? 4 : 2;
+  st->band_page = INT32_MIN;
+  if (diffuse) {
+    st->err = (int16_t *) (st + 1);
+    st->err_next = st->err + width + 2;
+    st->band = (uint8_t *) (st->err_next + width + 2);
+  } else {
+    st->band = (uint8_t *) (st + 1);
+  }
+  if (gray)
+    st->band_gray = st->band + width;
+  return st;
+}
+
+uint16_t mgos_sh1106_gray_stream_rows (struct mgos_sh1106_gray_stream *st, const uint8_t *rows, uint16_t count, size_t stride)
+{
+  uint16_t done;
+  int32_t dy, page;
+
+  if (st == NULL || rows == NULL)
+    return 0;
+
+  if (stride == 0)
+    stride = st->width;
+  for (done = 0; done < count && st->row < st->height; ++done, ++st->row, rows += stride) {
+    dy = st->y + st->row;
+    page = (dy - (dy & 7)) / 8;
+    if (page != st->band_page) {
+      _flush_band (st);
+      st->band_page = page;
+    }
+    st->band_rows |= 1 << (dy & 7);
+    if (st->dither == SH1106_DITHER_FLOYD_STEINBERG)
+      _diffuse_row (st, rows, 1 << (dy & 7));
+    else if (dy >= 0 && dy < st->s->height)
+      _bayer_row (st, rows, dy, 1 << (dy & 7));
+  }
+  return done;
+}
+
+void mgos_sh1106_gray_stream_end (struct mgos_sh1106_gray_stream *st)
+{
+  if (st == NULL)
+    return;
+
+  _flush_band (st);
+  sh1106_release (st);
+}
+
+bool mgos_sh1106_draw_gray_image (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint16_t width, uint16_t height,
+                                  const uint8_t *pixels, size_t stride, mgos_sh1106_dither_t dither)
+{
+  struct mgos_sh1106_gray_stream *st;
+
+  if (pixels == NULL)
+    return false;
+
+  st = mgos_sh1106_gray_stream_begin (oled, x, y, width, height, dither);
+  if (st == NULL)
+    return false;
+  mgos_sh1106_gray_stream_rows (st, pixels, height, stride);
+  mgos_sh1106_gray_stream_end (st);
+  return true;
+}
@@ -3,63 +3,210 @@
 #include <string.h>
 
 #include "mgos_i2c.h"
+#include "mgos_timers.h"
 
 #include "common/cs_dbg.h"
 
 #include "sh1106.h"
+#include "sh1106_internal.h"
 #include "fonts.h"
 
-#ifdef __GNUC__
-#define UNUSED(x) x __attribute__((unused))
-#else
-#define UNUSED(x) x
+_Static_assert (sizeof (struct mgos_sh1106) <= sizeof (((mgos_sh1106_storage_t *) 0)->instance),
+                "SH1106_INSTANCE_WORDS is too small for struct mgos_sh1106");
+
+static struct mgos_sh1106 *s_global_sh1106;
+#if SH1106_STATIC_ALLOC
+static mgos_sh1106_storage_t s_global_storage;
 #endif
 
-typedef struct mgos_sh1106
+static void *(*s_alloc) (size_t size, void *ctx);
+static void (*s_release) (void *ptr, void *ctx);
+static void *s_alloc_ctx;
+
+void *sh1106_alloc (size_t size)
 {
-  uint8_t address;              // I2C address
-  uint8_t width;                // panel width
-  uint8_t height;               // panel height
-  uint8_t *buffer;              // display buffer
-  uint8_t refresh_top;          // 'Dirty' window corners
-  uint8_t refresh_left;
-  uint8_t refresh_right;
-  uint8_t refresh_bottom;
-  const font_info_t *font;      // current font
-  struct mgos_i2c *i2c;         // i2c connection
-} mgos_sh1106;
+  void *ptr;
+
+  if (s_alloc == NULL)
+    return calloc (1, size);
+  ptr = s_alloc (size, s_alloc_ctx);
+  if (ptr != NULL)
+    memset (ptr, 0, size);
+  return ptr;
+}
 
-static struct mgos_sh1106 *s_global_sh1106;
+void sh1106_release (void *ptr)
+{
+  if (ptr == NULL)
+    return;
+  if (s_release != NULL)
+    s_release (ptr, s_alloc_ctx);
+  else if (s_alloc == NULL)
+    free (ptr);
+}
 
 static inline bool _command (struct mgos_sh1106 *oled, uint8_t cmd)
 {
   return mgos_i2c_write_reg_b (oled->i2c, oled->address, 0x80, cmd);
 }
 
+// Send several commands in one transfer (control byte with Co = 0, D/C = 0)
+static inline bool _commands (struct mgos_sh1106 *oled, const uint8_t *cmds, size_t len)
+{
+  return mgos_i2c_write_reg_n (oled->i2c, oled->address, 0x00, len, cmds);
+}
+
+// Controller init profiles, selected at runtime from the configured panel size
+static const uint8_t s_init_128x64[] = {
+  SH1106_DISPLAYOFF,
+  SH1106_SETDISPLAYCLOCKDIV, 0x80,
+  SH1106_SETMULTIPLEX, 0x3f,
+  SH1106_SETDISPLAYOFFSET, 0x00,
+  SH1106_SETSTARTLINE | 0x00,
+  SH1106_CHARGEPUMP, 0x14,
+  SH1106_MEMORYMODE, 0x00,
+  SH1106_SEGREMAP | 0x1,
+  SH1106_COMSCANDEC,
+  SH1106_SETCOMPINS, 0x12,
+  SH1106_SETCONTRAST, 0xcf,
+  SH1106_SETPRECHARGE, 0xf1,
+  SH1106_SETVCOMDETECT, 0x40,
+  SH1106_DISPLAYALLON_RESUME,
+  SH1106_NORMALDISPLAY,
+};
+
+static const uint8_t s_init_128x32[] = {
+  SH1106_DISPLAYOFF,
+  SH1106_SETDISPLAYCLOCKDIV, 0x80,
+  SH1106_SETMULTIPLEX, 0x1f,
+  SH1106_SETDISPLAYOFFSET, 0x00,
+  SH1106_SETSTARTLINE | 0x00,
+  SH1106_CHARGEPUMP, 0x14,
+  SH1106_MEMORYMODE, 0x00,
+  SH1106_SEGREMAP | 0x1,
+  SH1106_COMSCANDEC,
+  SH1106_SETCOMPINS, 0x02,
+  SH1106_SETCONTRAST, 0x8f,
+  SH1106_SETPRECHARGE, 0xf1,
+  SH1106_SETVCOMDETECT, 0x40,
+  SH1106_DISPLAYALLON_RESUME,
+  SH1106_NORMALDISPLAY,
+};
+
+static const uint8_t s_init_96x16[] = {
+  SH1106_DISPLAYOFF,
+  SH1106_SETDISPLAYCLOCKDIV, 0x80,
+  SH1106_SETMULTIPLEX, 0x0f,
+  SH1106_SETDISPLAYOFFSET, 0x00,
+  SH1106_SETSTARTLINE | 0x00,
+  SH1106_CHARGEPUMP, 0x14,
+  SH1106_MEMORYMODE, 0x00,
+  SH1106_SEGREMAP | 0x1,
+  SH1106_COMSCANDEC,
+  SH1106_SETCOMPINS, 0x02,
+  SH1106_SETCONTRAST, 0xaf,
+  SH1106_SETPRECHARGE, 0xf1,
+  SH1106_SETVCOMDETECT, 0x40,
+  SH1106_DISPLAYALLON_RESUME,
+  SH1106_NORMALDISPLAY,
+};
+
+struct sh1106_profile
+{
+  uint8_t width;
+  uint8_t height;
+  uint8_t col_offset;           // first RAM column wired to the panel
+  const uint8_t *init;          // command stream sent at startup
+  uint8_t init_len;
+};
+
+static const struct sh1106_profile s_profiles[] = {
+  {128, 64, 2, s_init_128x64, sizeof (s_init_128x64)},
+  {128, 32, 2, s_init_128x32, sizeof (s_init_128x32)},
+  {96, 16, 18, s_init_96x16, sizeof (s_init_96x16)},
+};
+
+// Exact match, otherwise the profile with the closest height
+static const struct sh1106_profile *_find_profile (uint8_t width, uint8_t height)
+{
+  const struct sh1106_profile *best = &s_profiles[0];
+
+  for (size_t i = 0; i < sizeof (s_profiles) / sizeof (s_profiles[0]); ++i) {
+    if (s_profiles[i].width == width && s_profiles[i].height == height)
+      return &s_profiles[i];
+    if (abs (s_profiles[i].height - height) < abs (best->height - height))
+      best = &s_profiles[i];
+  }
+  return best;
+}
+
+void mgos_sh1106_set_allocator (void *(*alloc) (size_t size, void *ctx), void (*release) (void *ptr, void *ctx), void *ctx)
+{
+  s_alloc = alloc;
+  s_release = release;
+  s_alloc_ctx = ctx;
+}
+
+static struct mgos_sh1106 *_setup (struct mgos_sh1106 *oled, const struct mgos_config_sh1106 *cfg);
+
 struct mgos_sh1106 *mgos_sh1106_create (const struct mgos_config_sh1106 *cfg)
 {
   struct mgos_sh1106 *oled = NULL;
-  oled = calloc (1, sizeof (*oled));
+  oled = sh1106_alloc (sizeof (*oled));
   if (oled == NULL)
     return NULL;
 
+  oled->canvas.buffer = sh1106_alloc (SH1106_CANVAS_BUFFER_SIZE);
+  if (oled->canvas.buffer == NULL) {
+    sh1106_release (oled);
+    return NULL;
+  }
+  oled->owns_instance = true;
+  oled->owns_canvas = true;
+  return _setup (oled, cfg);
+}
+
+struct mgos_sh1106 *mgos_sh1106_create_static (const struct mgos_config_sh1106 *cfg, mgos_sh1106_storage_t *storage)
+{
+  struct mgos_sh1106 *oled;
+
+  if (storage == NULL)
+    return NULL;
+
+  oled = (struct mgos_sh1106 *) storage->instance;
+  memset (storage, 0, sizeof (*storage));
+  oled->canvas.buffer = storage->buffer;
+  return _setup (oled, cfg);
+}
+
+static struct mgos_sh1106 *_setup (struct mgos_sh1106 *oled, const struct mgos_config_sh1106 *cfg)
+{
+  const struct sh1106_profile *profile;
+
   oled->address = cfg->address;
   oled->width = cfg->width;
   oled->height = cfg->height;
-  oled->buffer = calloc (cfg->width * cfg->height / 8, sizeof (uint8_t));
+#if SH1106_FIXED_GEOMETRY
+  if (cfg->width != SH1106_LCDWIDTH || cfg->height != SH1106_LCDHEIGHT) {
+    LOG (LL_WARN, ("SH1106 built for %dx%d, ignoring configured %dx%d", SH1106_LCDWIDTH, SH1106_LCDHEIGHT, cfg->width, cfg->height));
+    oled->width = SH1106_LCDWIDTH;
+    oled->height = SH1106_LCDHEIGHT;
+  }
+#endif
+  oled->canvas.width = SH1106_RAM_WIDTH;
+  oled->canvas.height = SH1106_RAM_HEIGHT;
+  oled->target = &oled->canvas;
   if (cfg->i2c.enable && cfg->i2c.scl_gpio != -1 && cfg->i2c.sda_gpio != -1) {
     LOG (LL_INFO, ("Using SH1106 GPIO config"));
-    struct mgos_config_i2c *i2c_cfg = NULL;
-    i2c_cfg = calloc (1, sizeof (*i2c_cfg));
-    if (i2c_cfg == NULL)
-      return NULL;
-    i2c_cfg->enable = cfg->i2c.enable;
-    i2c_cfg->unit_no = cfg->i2c.unit_no;
-    i2c_cfg->freq = cfg->i2c.freq;
-    i2c_cfg->debug = cfg->i2c.debug;
-    i2c_cfg->scl_gpio = cfg->i2c.scl_gpio;
-    i2c_cfg->sda_gpio = cfg->i2c.sda_gpio;
-    oled->i2c = mgos_i2c_create (i2c_cfg);
+    struct mgos_config_i2c i2c_cfg;
+    memset (&i2c_cfg, 0, sizeof (i2c_cfg));
+    i2c_cfg.enable = cfg->i2c.enable;
+    i2c_cfg.unit_no = cfg->i2c.unit_no;
+    i2c_cfg.freq = cfg->i2c.freq;
+    i2c_cfg.debug = cfg->i2c.debug;
+    i2c_cfg.scl_gpio = cfg->i2c.scl_gpio;
+    i2c_cfg.sda_gpio = cfg->i2c.sda_gpio;
+    oled->i2c = mgos_i2c_create (&i2c_cfg);
   } else {
     LOG (LL_INFO, ("Using global GPIO config"));
     oled->i2c = mgos_i2c_get_global ();
@@ -69,126 +216,13 @@ struct mgos_sh1106 *mgos_sh1106_create (const struct mgos_config_sh1106 *cfg)
     goto out_err;
   }
 
-  LOG (LL_DEBUG, ("Sending controller startup sequence"));
-
-  #if defined SH1106_128_32
-  _command (oled, SH1106_DISPLAYOFF);
-  _command (oled, SH1106_SETDISPLAYCLOCKDIV);
-  _command (oled, 0x80);        // Suggested value 0x80
-  _command (oled, SH1106_SETMULTIPLEX);
-  _command (oled, 0x1f);
-
-//  _command (oled, oled->height - 1);
-  _command (oled, SH1106_SETDISPLAYOFFSET);
-  _command (oled, 0x00);        // 0 no offset
-  _command (oled, SH1106_SETSTARTLINE | 0x00);        // SH1106_SETSTARTLINE line #0
-  _command (oled, SH1106_CHARGEPUMP);
+  profile = _find_profile (oled->width, oled->height);
+  if (profile->width != oled->width || profile->height != oled->height)
+    LOG (LL_WARN, ("No SH1106 profile for %dx%d, using %dx%d", oled->width, oled->height, profile->width, profile->height));
+  oled->col_offset = (cfg->col_offset >= 0) ? cfg->col_offset : profile->col_offset;
 
-  LOG (LL_DEBUG, ("128x32: EXTERNALVCC false"));
-//    if (vccstate == SH1106_EXTERNALVCC) {
-//      _command(oled, 0x10);
-//    } else {
-      _command(oled, 0x14);
-//    }
-    _command(oled, SH1106_MEMORYMODE);
-
-  _command (oled, SH1106_SEGREMAP | 0x1);
-  _command (oled, SH1106_COMSCANDEC);
-  _command (oled, SH1106_SETCOMPINS);
-  _command(0x02);
-//  _command (oled, oled->height < 64 ? 0x02 : 0x12);
-  _command (oled, SH1106_SETCONTRAST);
-  _command (oled, 0x8f);        // default contrast ratio
-  _command (oled, SH1106_SETPRECHARGE);
-//  if (vccstate == SH1106_EXTERNALVCC) {
-//    _command(oled, 0x22);
-//  } else {
-    _command(oled, 0xf1);
-//  }
-  _command(oled, SH1106_SETVCOMDETECT);
-  _command(oled, SH1106_DISPLAYALLON_RESUME);
-  _command(oled, SH1106_NORMALDISPLAY);
-  #endif
-
-  #if defined SH1106_128_64
-  _command(oled, SH1106_DISPLAYOFF);
-  _command(oled, SH1106_SETDISPLAYCLOCKDIV);
-  _command(oled, 0x80);
-  _command(oled, SH1106_SETMULTIPLEX);
-  _command(oled, 0x3F);
-  _command(oled, SH1106_SETDISPLAYOFFSET);
-  _command(oled, 0x0);
-  _command(oled, SH1106_SETSTARTLINE | 0x0);
-  _command(oled, SH1106_CHARGEPUMP);
-  LOG (LL_DEBUG, ("128x64: EXTERNALVCC false"));
-//  if (vccstate == SH1106_EXTERNALVCC) {
-//    _command(oled, 0x10);
-//  } else {
-    _command(oled, 0x14);
-//  }
-  _command(oled, SH1106_MEMORYMODE);
-  _command(oled, 0x00);
-  _command(oled, SH1106_SEGREMAP | 0x1);
-  _command(oled, SH1106_COMSCANDEC);
-  _command(oled, SH1106_SETCOMPINS);
-  _command(oled, 0x12);
-  _command(oled, SH1106_SETCONTRAST);
-//  if (vccstate == SH1106_EXTERNALVCC) {
-//    _command(oled, 0x9F);
-//  } else {
-    _command(oled, 0xCF);
-//  }
-  _command(oled, SH1106_SETPRECHARGE);
-//  if (vccstate == SH1106_EXTERNALVCC) {
-//    _command(oled, 0x22);
-//  } else {
-    _command(oled, 0xF1);
-//  }
-  _command(oled, SH1106_SETVCOMDETECT);
-  _command(oled, 0x40);
-  _command(oled, SH1106_DISPLAYALLON_RESUME);
-  _command(oled, SH1106_NORMALDISPLAY);
-  #endif
-
-  #if defined SH1106_96_16
-  _command(oled, SH1106_DISPLAYOFF);
-  _command(oled, SH1106_SETDISPLAYCLOCKDIV);
-  _command(oled, 0x80);
-  _command(oled, SH1106_SETMULTIPLEX);
-  _command(oled, 0x0F);
-  _command(oled, SH1106_SETDISPLAYOFFSET);
-  _command(oled, 0x00);
-  _command(oled, SH1106_SETSTARTLINE | 0x0);
-  _command(oled, SH1106_CHARGEPUMP);
-  LOG (LL_DEBUG, ("96x16: EXTERNALVCC false"));
-//  if (vccstate == SH1106_EXTERNALVCC) {
-//    _command(oled, 0x10);
-//  } else {
-    _command(oled, 0x14);
-//  }
-  _command(oled, SH1106_MEMORYMODE);
-  _command(oled, 0x00);
-  _command(oled, SH1106_SEGREMAP | 0x1);
-  _command(oled, SH1106_COMSCANDEC);
-  _command(oled, SH1106_SETCOMPINS);
-  _command(oled, 0x2);
-  _command(oled, SH1106_SETCONTRAST);
-//  if (vccstate == SH1106_EXTERNALVCC) {
-//    _command(oled, 0x10);
-//  } else {
-    _command(oled, 0xaf);
-//  }
-  _command(oled, SH1106_SETPRECHARGE);
-//  if (vccstate == SH1106_EXTERNALVCC) {
-//    _command(oled, 0x22);
-//  } else {
-    _command(oled, 0xf1);
-//  }
-  _command(oled, SH1106_SETVCOMDETECT);
-  _command(oled, 0x40);
-  _command(oled, SH1106_DISPLAYALLON_RESUME);
-  _command(oled, SH1106_NORMALDISPLAY);
-  #endif
+  LOG (LL_DEBUG, ("Sending controller startup sequence"));
+  _commands (oled, profile->init, profile->init_len);
 
   LOG (LL_DEBUG, ("Clearing screen buffer"));
   mgos_sh1106_clear (oled);
@@ -204,7 +238,10 @@ struct mgos_sh1106 *mgos_sh1106_create (const struct mgos_config_sh1106 *cfg)
 
 out_err:
   LOG (LL_ERROR, ("SH1106 setup failed"));
-  free (oled);
+  if (oled->owns_canvas)
+    sh1106_release (oled->canvas.buffer);
+  if (oled->owns_instance)
+    sh1106_release (oled);
   return NULL;
 }
 
@@ -214,6 +251,13 @@ void mgos_sh1106_close (struct mgos_sh1106 *oled)
     return;
 
   LOG (LL_INFO, ("SH1106 close"));
+  mgos_sh1106_set_auto_refresh (oled, 0, 0);
+  sh1106_regions_free (oled);
+#if SH1106_LATENCY_STATS
+  sh1106_latency_free (oled);
+#endif
+  mgos_sh1106_set_gray_mode (oled, false, 0);
+  mgos_sh1106_set_rotation (oled, SH1106_ROTATE_0);
   _command (oled, SH1106_DISPLAYOFF);
   _command (oled, SH1106_CHARGEPUMP);
   _command (oled, SH1106_CHARGEPUMPOFF);
@@ -221,10 +265,11 @@ void mgos_sh1106_close (struct mgos_sh1106 *oled)
   if (oled->i2c)
     mgos_i2c_close (oled->i2c);
 
-  if (oled->buffer)
-    free (oled->buffer);
+  if (oled->owns_canvas)
+    sh1106_release (oled->canvas.buffer);
 
-  free (oled);
+  if (oled->owns_instance)
+    sh1106_release (oled);
 }
 
 uint8_t mgos_sh1106_get_width (struct mgos_sh1106 *oled)
@@ -232,7 +277,7 @@ uint8_t mgos_sh1106_get_width (struct mgos_sh1106 *oled)
   if (oled == NULL)
     return 0;
 
-  return oled->width;
+  return (oled->rotated != NULL) ? oled->rotated->width : oled->width;
 }
 
 uint8_t mgos_sh1106_get_height (struct mgos_sh1106 * oled)
@@ -240,161 +285,824 @@ uint8_t mgos_sh1106_get_height (struct mgos_sh1106 * oled)
   if (oled == NULL)
     return 0;
 
-  return oled->height;
+  return (oled->rotated != NULL) ? oled->rotated->height : oled->height;
 }
 
 void mgos_sh1106_clear (struct mgos_sh1106 *oled)
 {
+  struct mgos_sh1106_surface *s;
+
   if (oled == NULL)
     return;
 
   LOG (LL_INFO, ("SH1106 clear"));
-  memset (oled->buffer, 0, (oled->width * oled->height / 8));
-  oled->refresh_right = oled->width - 1;
-  oled->refresh_bottom = oled->height - 1;
-  oled->refresh_top = 0;
-  oled->refresh_left = 0;
+  s = oled->target;
+  memset (s->buffer, 0, (size_t) s->width * (s->height / 8));
+  if (s->gray != NULL)
+    memset (s->gray, 0, (size_t) s->width * (s->height / 8));
+  _mark_dirty (s, 0, 0, s->width - 1, s->height - 1);
+}
+
+static inline uint8_t _start_line (struct mgos_sh1106 *oled)
+{
+  return (oled->row_base + oled->view_y) & (SH1106_RAM_HEIGHT - 1);
+}
+
+// Bitmask of RAM pages holding rows currently shown on the panel. An
+// unaligned start line on a 64-row panel shows the first page at both the
+// top and the bottom, so the span is at most 8 pages.
+static uint8_t _visible_pages (struct mgos_sh1106 *oled)
+{
+  uint8_t first = _start_line (oled) / 8;
+  uint8_t count = ((_start_line (oled) & 7) + oled->height + 7) / 8;
+  uint8_t mask = 0;
+
+  if (count > SH1106_RAM_HEIGHT / 8)
+    count = SH1106_RAM_HEIGHT / 8;
+  for (uint8_t i = 0; i < count; ++i)
+    mask |= 1 << ((first + i) & 7);
+  return mask;
+}
+
+// Mark the RAM pages holding canvas rows top..bottom (inside the RAM window) as stale
+static void _mark_stale_rows (struct mgos_sh1106 *oled, int32_t top, int32_t bottom)
+{
+  if (bottom - top >= SH1106_RAM_HEIGHT - 1) {
+    oled->stale_pages = 0xff;
+    return;
+  }
+  for (int32_t row = top; row <= bottom + 7; row += 8) {
+    if (row > bottom)
+      row = bottom;
+    oled->stale_pages |= 1 << (((row + oled->row_base) & (SH1106_RAM_HEIGHT - 1)) / 8);
+  }
+}
+
+static void _set_ram_position (struct mgos_sh1106 *oled, uint8_t page, uint8_t column)
+{
+  uint8_t cmds[] = {
+    SH1106_SETPAGEADDR | (page & 0x07),
+    SH1106_SETLOWCOLUMN | (column & 0x0f),
+    SH1106_SETHIGHCOLUMN | (column >> 4),
+  };
+
+  _commands (oled, cmds, sizeof (cmds));
+}
+
+// 8 rows of column x starting at row (bit 0 = row) from a page-format plane,
+// zero outside the plane
+static inline uint8_t _plane_rows8 (const uint8_t *plane, uint16_t width, uint16_t height, uint16_t x, int32_t row)
+{
+  const uint8_t *col = plane + x;
+  uint8_t shift = row & 7;
+  int32_t page = row >> 3;
+  int32_t pages = height / 8;
+  uint8_t v = 0;
+
+  if (page >= 0 && page < pages)
+    v = col[page * width] >> shift;
+  if (shift && page + 1 >= 0 && page + 1 < pages)
+    v |= col[(page + 1) * width] << (8 - shift);
+  return v;
+}
+
+static inline uint8_t _surface_rows8 (const struct mgos_sh1106_surface *s, uint16_t x, int32_t row)
+{
+  return _plane_rows8 (s->buffer, s->width, s->height, x, row);
+}
+
+// Clip canvas columns to the ones stored in controller RAM
+static bool _ram_columns (struct mgos_sh1106 *oled, int32_t *left, int32_t *right)
+{
+  int32_t ram_left = (int32_t) oled->view_x - oled->col_offset;     // canvas column stored in RAM column 0
+
+  if (*left < ram_left)
+    *left = ram_left;
+  if (*left < 0)
+    *left = 0;
+  if (*right > ram_left + SH1106_RAM_WIDTH - 1)
+    *right = ram_left + SH1106_RAM_WIDTH - 1;
+  if (*right > oled->canvas.width - 1)
+    *right = oled->canvas.width - 1;
+  return *left <= *right;
+}
+
+// The RAM caches a 64-row window of the canvas as a ring: RAM row =
+// (canvas row + row_base) % 64 and RAM column = canvas column - view_x +
+// col_offset. Return the canvas row held in bit 0 of a RAM page.
+static inline int32_t _ram_page_row (struct mgos_sh1106 *oled, uint8_t ram_page)
+{
+  return oled->win_y + ((ram_page * 8 - oled->row_base - oled->win_y) & (SH1106_RAM_HEIGHT - 1));
+}
+
+// Stitch the bytes of a RAM page for len columns from left out of a plane
+// with the canvas geometry (the canvas itself or its gray plane)
+static void _ram_page_bytes (struct mgos_sh1106 *oled, const uint8_t *plane, uint8_t ram_page, int32_t left, uint8_t len, uint8_t *out)
+{
+  int32_t row = _ram_page_row (oled, ram_page);
+  int32_t split = oled->win_y + SH1106_RAM_HEIGHT - row;     // bits before the window wraps
+  uint8_t mask = (split < 8) ? (1 << split) - 1 : 0xff;
+  uint16_t cw = oled->canvas.width, ch = oled->canvas.height;
+
+  for (uint8_t i = 0; i < len; ++i) {
+    out[i] = _plane_rows8 (plane, cw, ch, left + i, row) & mask;
+    if (mask != 0xff)
+      out[i] |= _plane_rows8 (plane, cw, ch, left + i, oled->win_y - split) & ~mask;
+  }
+}
+
+// Send canvas columns left..right of one RAM page. Pages that line up with
+// canvas pages are sent straight from the canvas; others are stitched.
+static void _write_ram_page (struct mgos_sh1106 *oled, uint8_t ram_page, int32_t left, int32_t right)
+{
+  uint8_t line[SH1106_RAM_WIDTH];
+  int32_t row = _ram_page_row (oled, ram_page);
+  uint8_t len;
+
+  if (!_ram_columns (oled, &left, &right))
+    return;
+
+  len = right - left + 1;
+  _set_ram_position (oled, ram_page, left - (oled->view_x - oled->col_offset));
+  if ((row & 7) == 0 && oled->win_y + SH1106_RAM_HEIGHT - row >= 8 && row + 8 <= oled->canvas.height) {
+    mgos_i2c_write_reg_n (oled->i2c, oled->address, 0x40, len, oled->canvas.buffer + (row / 8) * oled->canvas.width + left);
+    return;
+  }
+  _ram_page_bytes (oled, oled->canvas.buffer, ram_page, left, len, line);
+  mgos_i2c_write_reg_n (oled->i2c, oled->address, 0x40, len, line);
+}
+
+bool sh1106_write_panel_page (struct mgos_sh1106 *oled, uint8_t panel_page, const uint8_t *data, uint8_t len)
+{
+  uint8_t line = _start_line (oled), ram_page;
+
+  if ((line & 7) || panel_page >= (oled->height + 7) / 8)
+    return false;
+
+  if (len > SH1106_RAM_WIDTH - oled->col_offset)
+    len = SH1106_RAM_WIDTH - oled->col_offset;
+  ram_page = (line / 8 + panel_page) & 7;
+  _set_ram_position (oled, ram_page, oled->col_offset);
+  mgos_i2c_write_reg_n (oled->i2c, oled->address, 0x40, len, data);
+  oled->stale_pages |= 1 << ram_page;
+  return true;
+}
+
+// Bitmask of RAM pages covering the canvas dirty window
+static uint8_t _dirty_ram_pages (struct mgos_sh1106 *oled)
+{
+  struct mgos_sh1106_surface *c = &oled->canvas;
+  int32_t top, bottom;
+  uint8_t first, count, dirty = 0;
+
+  // Only rows inside the RAM window have a place in the controller
+  top = (c->refresh_top > oled->win_y) ? c->refresh_top : oled->win_y;
+  bottom = (c->refresh_bottom < oled->win_y + SH1106_RAM_HEIGHT - 1) ? c->refresh_bottom : oled->win_y + SH1106_RAM_HEIGHT - 1;
+  if (top > bottom || c->refresh_left > c->refresh_right)
+    return 0;
+
+  // may wrap past the last RAM page
+  first = (top + oled->row_base) / 8;
+  count = (bottom + oled->row_base) / 8 - (top + oled->row_base) / 8 + 1;
+  if (count > SH1106_RAM_HEIGHT / 8)
+    count = SH1106_RAM_HEIGHT / 8;
+  for (uint8_t i = 0; i < count; ++i)
+    dirty |= 1 << ((first + i) & 7);
+  return dirty;
+}
+
+// Turn the canvas dirty window into RAM pages. Shown pages are owed the
+// dirty columns until sent; pages the panel doesn't show are only
+// remembered as stale, and stale pages go out in full anyway.
+static void _owe_dirty_pages (struct mgos_sh1106 *oled, uint8_t visible)
+{
+  struct mgos_sh1106_surface *c = &oled->canvas;
+  uint8_t dirty = _dirty_ram_pages (oled);
+
+  if (dirty) {
+    if (oled->pending_pages == 0) {
+      oled->pending_left = c->refresh_left;
+      oled->pending_right = c->refresh_right;
+    } else {
+      if (oled->pending_left > c->refresh_left)
+        oled->pending_left = c->refresh_left;
+      if (oled->pending_right < c->refresh_right)
+        oled->pending_right = c->refresh_right;
+    }
+    oled->pending_pages |= dirty;
+  }
+  oled->stale_pages |= oled->pending_pages & ~visible;
+  oled->pending_pages &= visible & ~oled->stale_pages;
+}
+
+void sh1106_refresh_now (struct mgos_sh1106 *oled, bool force)
+{
+  uint8_t page, visible;
+
+  if (oled->rotated != NULL)
+    sh1106_rotate_dirty (oled, force);
+  if (force) {
+    oled->canvas.refresh_top = 0;
+    oled->canvas.refresh_left = 0;
+    oled->canvas.refresh_right = oled->canvas.width - 1;
+    oled->canvas.refresh_bottom = oled->canvas.height - 1;
+  }
+
+  visible = _visible_pages (oled);
+  _owe_dirty_pages (oled, visible);
+  for (page = 0; page < SH1106_RAM_HEIGHT / 8; ++page) {
+    if (oled->pending_pages & (1 << page))
+      _write_ram_page (oled, page, oled->pending_left, oled->pending_right);
+  }
+  oled->pending_pages = 0;
+
+  // Bring back in sync any shown page that went stale while off screen
+  for (page = 0; page < SH1106_RAM_HEIGHT / 8; ++page) {
+    if (visible & oled->stale_pages & (1 << page)) {
+      _write_ram_page (oled, page, 0, oled->canvas.width - 1);
+      oled->stale_pages &= ~(1 << page);
+    }
+  }
+#if SH1106_LATENCY_STATS
+  if (oled->canvas.dirty_since)
+    sh1106_latency_record (oled, mgos_uptime_micros () - oled->canvas.dirty_since);
+#endif
+  _reset_dirty (&oled->canvas);
+}
+
+void sh1106_send_dirty (struct mgos_sh1106 *oled)
+{
+  uint8_t dirty, visible;
+
+  if (oled->rotated != NULL)
+    sh1106_rotate_dirty (oled, false);
+
+  visible = _visible_pages (oled);
+  dirty = _dirty_ram_pages (oled);
+  oled->stale_pages |= dirty & ~visible;
+  for (uint8_t page = 0; page < SH1106_RAM_HEIGHT / 8; ++page) {
+    if (dirty & visible & (1 << page))
+      _write_ram_page (oled, page, oled->canvas.refresh_left, oled->canvas.refresh_right);
+  }
+#if SH1106_LATENCY_STATS
+  if (oled->canvas.dirty_since)
+    sh1106_latency_record (oled, mgos_uptime_micros () - oled->canvas.dirty_since);
+#endif
+  _reset_dirty (&oled->canvas);
+}
+
+bool mgos_sh1106_set_priority (struct mgos_sh1106 *oled, uint8_t slot, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                               uint8_t priority)
+{
+  struct sh1106_priority_region *r;
+
+  if (oled == NULL || slot >= SH1106_PRIORITY_REGIONS)
+    return false;
+
+  r = &oled->priority[slot];
+  r->x = x;
+  r->y = y;
+  r->width = w;
+  r->height = h;
+  r->priority = priority;
+  return true;
+}
+
+// Highest priority of the regions overlapping canvas columns left..right of a RAM page
+static uint8_t _page_priority (struct mgos_sh1106 *oled, uint8_t ram_page, int32_t left, int32_t right)
+{
+  const struct sh1106_priority_region *r;
+  int32_t row = _ram_page_row (oled, ram_page);
+  uint8_t best = 0;
+
+  for (uint8_t i = 0; i < SH1106_PRIORITY_REGIONS; ++i) {
+    r = &oled->priority[i];
+    if (r->priority > best && r->x <= right && r->x + r->width > left && r->y <= row + 7 && r->y + r->height > row)
+      best = r->priority;
+  }
+  return best;
+}
+
+bool mgos_sh1106_refresh_progressive (struct mgos_sh1106 *oled, uint32_t max_us, uint32_t max_bytes)
+{
+  struct mgos_sh1106_surface *c;
+  int32_t left, right;
+  uint8_t order[SH1106_RAM_HEIGHT / 8], prio[SH1106_RAM_HEIGHT / 8];
+  uint8_t page, visible, dirty, n = 0, k;
+  uint32_t bytes = 0;
+  int64_t start;
+#if SH1106_LATENCY_STATS
+  int64_t since;
+#endif
+
+  if (oled == NULL)
+    return false;
+
+  start = mgos_uptime_micros ();
+  if (oled->rotated != NULL)
+    sh1106_rotate_dirty (oled, false);
+  c = &oled->canvas;
+
+  // The same pages a full refresh would send: shown ones under the dirty
+  // rows, and stale ones in full. What doesn't fit the budget stays owed
+  // as pages, so the next call picks up where this one stopped.
+  visible = _visible_pages (oled);
+  _owe_dirty_pages (oled, visible);
+#if SH1106_LATENCY_STATS
+  since = c->dirty_since;
+#endif
+  _reset_dirty (c);
+  dirty = oled->pending_pages | (visible & oled->stale_pages);
+
+  // highest priority first, by insertion; ties keep page order
+  for (page = 0; page < SH1106_RAM_HEIGHT / 8; ++page) {
+    if (!(dirty & (1 << page)))
+      continue;
+    if (oled->stale_pages & (1 << page))
+      prio[page] = _page_priority (oled, page, 0, c->width - 1);
+    else
+      prio[page] = _page_priority (oled, page, oled->pending_left, oled->pending_right);
+    for (k = n++; k > 0 && prio[order[k - 1]] < prio[page]; --k)
+      order[k] = order[k - 1];
+    order[k] = page;
+  }
+
+  for (k = 0; k < n; ++k) {
+    page = order[k];
+    if (oled->stale_pages & (1 << page)) {
+      left = 0;
+      right = c->width - 1;
+    } else {
+      left = oled->pending_left;
+      right = oled->pending_right;
+    }
+    if (!_ram_columns (oled, &left, &right))
+      left = right + 1;
+    if (k > 0 && ((max_bytes && bytes + (right - left + 1) > max_bytes) ||
+                  (max_us && mgos_uptime_micros () - start >= max_us)))
+      break;
+    if (left <= right)
+      _write_ram_page (oled, page, left, right);
+    bytes += right - left + 1;
+    oled->stale_pages &= ~(1 << page);
+    oled->pending_pages &= ~(1 << page);
+    dirty &= ~(1 << page);
+  }
+
+  if (dirty == 0) {
+#if SH1106_LATENCY_STATS
+    if (since)
+      sh1106_latency_record (oled, mgos_uptime_micros () - since);
+#endif
+    return true;
+  }
+#if SH1106_LATENCY_STATS
+  // what is still owed keeps its age
+  c->dirty_since = since;
+#endif
+  return false;
 }
 
 void mgos_sh1106_refresh (struct mgos_sh1106 *oled, bool force)
 {
-  uint8_t page_start, page_end;
-
-  if (oled == NULL)
-    return;
-
-  if (force || (oled->refresh_top <= 0 && oled->refresh_bottom >= oled->height - 1 && oled->refresh_left <= 0 && oled->refresh_right >= oled->width - 1)) {
-    _command (oled, SH1106_COLUMNADDR);
-    _command (oled, 0);         // column start
-    _command (oled, 127);       // column end
-    _command (oled, SH1106_PAGEADDR);
-    _command (oled, 0);         // page start
-    _command (oled, (oled->height / 8) - 1);    // page end
-    mgos_i2c_write_reg_n (oled->i2c, oled->address, 0x40, oled->height * oled->width / 8, oled->buffer);
-  } else if ((oled->refresh_top <= oled->refresh_bottom)
-             && (oled->refresh_left <= oled->refresh_right)) {
-    page_start = oled->refresh_top / 8;
-    page_end = oled->refresh_bottom / 8;
-    _command (oled, SH1106_COLUMNADDR);
-    _command (oled, oled->refresh_left);        // column start
-    _command (oled, oled->refresh_right);       // column end
-    _command (oled, SH1106_PAGEADDR);
-    _command (oled, page_start);        // page start
-    _command (oled, page_end);  // page end
-
-    for (uint8_t i = page_start; i <= page_end; ++i) {
-      uint16_t start = i * oled->width + oled->refresh_left;
-      uint16_t len = oled->refresh_right - oled->refresh_left + 1;
-      mgos_i2c_write_reg_n (oled->i2c, oled->address, 0x40, len, oled->buffer + start);
+  if (oled == NULL)
+    return;
+
+  // in auto refresh mode the next frame sends it
+  if (sh1106_schedule_request (oled, force))
+    return;
+  sh1106_refresh_now (oled, force);
+}
+
+// Temporal dithering: each level is the pair (canvas bit, gray bit) and
+// subframes cycle through canvas | gray, canvas, canvas & ~gray, so dark
+// gray is lit one subframe in three and light gray two in three.
+static void _gray_tick (void *arg)
+{
+  struct mgos_sh1106 *oled = (struct mgos_sh1106 *) arg;
+  uint8_t line[SH1106_RAM_WIDTH], gray[SH1106_RAM_WIDTH];
+  int32_t left = oled->view_x, right = oled->view_x + oled->width - 1;
+  uint8_t visible, len, i, page, any;
+
+  oled->gray_phase = (oled->gray_phase + 1) % 3;
+  ++oled->gray_subframes;
+  if (!_ram_columns (oled, &left, &right))
+    return;
+
+  len = right - left + 1;
+  visible = _visible_pages (oled);
+  for (page = 0; page < SH1106_RAM_HEIGHT / 8; ++page) {
+    if (!(visible & (1 << page)) || (oled->stale_pages & (1 << page)))
+      continue;
+    // pages without gray pixels look the same in every subframe
+    _ram_page_bytes (oled, oled->canvas.gray, page, left, len, gray);
+    for (i = 0, any = 0; i < len; ++i)
+      any |= gray[i];
+    if (!any)
+      continue;
+    _ram_page_bytes (oled, oled->canvas.buffer, page, left, len, line);
+    for (i = 0; i < len; ++i) {
+      if (oled->gray_phase == 0)
+        line[i] |= gray[i];
+      else if (oled->gray_phase == 2)
+        line[i] &= ~gray[i];
     }
+    _set_ram_position (oled, page, left - (oled->view_x - oled->col_offset));
+    mgos_i2c_write_reg_n (oled->i2c, oled->address, 0x40, len, line);
   }
-  // reset dirty area
-  oled->refresh_top = 255;
-  oled->refresh_left = 255;
-  oled->refresh_right = 0;
-  oled->refresh_bottom = 0;
 }
 
-void mgos_sh1106_draw_pixel (struct mgos_sh1106 *oled, int8_t x, int8_t y, mgos_sh1106_color_t color)
+bool mgos_sh1106_set_gray_mode (struct mgos_sh1106 *oled, bool enable, uint16_t subframe_hz)
 {
-  uint16_t UNUSED (index) = x + (y / 8) * oled->width;
+  struct mgos_sh1106_surface *c;
+
   if (oled == NULL)
+    return false;
+
+  c = &oled->canvas;
+  if (oled->gray_timer != MGOS_INVALID_TIMER_ID) {
+    mgos_clear_timer (oled->gray_timer);
+    oled->gray_timer = MGOS_INVALID_TIMER_ID;
+  }
+  if (!enable) {
+    if (c->gray != NULL) {
+      sh1106_release (c->gray);
+      c->gray = NULL;
+      // RAM may hold a dithered subframe
+      _mark_dirty (c, 0, 0, c->width - 1, c->height - 1);
+    }
+    return true;
+  }
+
+  if (subframe_hz == 0)
+    return false;
+  if (c->gray == NULL) {
+    c->gray = sh1106_alloc ((size_t) c->width * (c->height / 8));
+    if (c->gray == NULL) {
+      LOG (LL_ERROR, ("SH1106 gray plane allocation failed"));
+      return false;
+    }
+  }
+  oled->gray_phase = 0;
+  oled->gray_subframes = 0;
+  oled->gray_since = mgos_uptime_micros ();
+  oled->gray_timer = mgos_set_timer ((subframe_hz < 1000) ? 1000 / subframe_hz : 1, MGOS_TIMER_REPEAT, _gray_tick, oled);
+  if (oled->gray_timer == MGOS_INVALID_TIMER_ID) {
+    LOG (LL_ERROR, ("SH1106 gray timer failed"));
+    mgos_sh1106_set_gray_mode (oled, false, 0);
+    return false;
+  }
+  LOG (LL_INFO, ("SH1106 gray mode on, %u subframes/s", subframe_hz));
+  return true;
+}
+
+float mgos_sh1106_get_gray_rate (struct mgos_sh1106 *oled, bool reset)
+{
+  int64_t now;
+  float rate;
+
+  if (oled == NULL || oled->gray_timer == MGOS_INVALID_TIMER_ID)
+    return 0;
+
+  now = mgos_uptime_micros ();
+  if (now <= oled->gray_since)
+    return 0;
+  rate = oled->gray_subframes * 1e6f / (now - oled->gray_since);
+  if (reset) {
+    oled->gray_subframes = 0;
+    oled->gray_since = now;
+  }
+  return rate;
+}
+
+// Shift every row of a page-format plane up (lines > 0) or down, clearing the rows shifted in
+static void _shift_rows (uint8_t *buf, uint16_t cw, uint16_t height, int16_t lines)
+{
+  uint16_t pages = height / 8;
+  uint16_t n = (lines > 0) ? lines : -lines;
+  uint16_t k = n / 8;
+  uint8_t m = n & 7;
+  uint8_t lo, hi;
+
+  if (n >= height) {
+    memset (buf, 0, (size_t) cw * pages);
     return;
+  }
+  if (lines > 0) {
+    for (uint16_t p = 0; p < pages; ++p) {
+      for (uint16_t x = 0; x < cw; ++x) {
+        lo = (p + k < pages) ? buf[(p + k) * cw + x] : 0;
+        hi = (p + k + 1 < pages) ? buf[(p + k + 1) * cw + x] : 0;
+        buf[p * cw + x] = m ? (lo >> m) | (hi << (8 - m)) : lo;
+      }
+    }
+  } else {
+    for (uint16_t p = pages; p-- > 0;) {
+      for (uint16_t x = 0; x < cw; ++x) {
+        hi = (p >= k) ? buf[(p - k) * cw + x] : 0;
+        lo = (p >= k + 1) ? buf[(p - k - 1) * cw + x] : 0;
+        buf[p * cw + x] = m ? (hi << m) | (lo >> (8 - m)) : hi;
+      }
+    }
+  }
+}
+
+void mgos_sh1106_scroll_vertical (struct mgos_sh1106 *oled, int16_t lines)
+{
+  int32_t top, bottom;
 
-  if ((x >= oled->width) || (x < 0) || (y >= oled->height) || (y < 0))
+  if (oled == NULL || lines == 0)
     return;
 
-  switch (color) {
+  // Move the canvas with the RAM ring so drawing coordinates stay put
+  _shift_rows (oled->canvas.buffer, oled->canvas.width, oled->canvas.height, lines);
+  if (oled->canvas.gray != NULL)
+    _shift_rows (oled->canvas.gray, oled->canvas.width, oled->canvas.height, lines);
+  oled->row_base = (oled->row_base + lines) & (SH1106_RAM_HEIGHT - 1);
+  _command (oled, SH1106_SETSTARTLINE | _start_line (oled));
+
+  // Rows still waiting for refresh moved along with their content
+  if (oled->canvas.refresh_top <= oled->canvas.refresh_bottom) {
+    top = (int32_t) oled->canvas.refresh_top - lines;
+    bottom = (int32_t) oled->canvas.refresh_bottom - lines;
+    _reset_dirty (&oled->canvas);
+    if (bottom >= 0 && top < oled->canvas.height)
+      _mark_dirty (&oled->canvas, 0, top < 0 ? 0 : top, oled->canvas.width - 1, bottom >= oled->canvas.height ? oled->canvas.height - 1 : bottom);
+  }
+
+  // Only window rows whose RAM row now belongs to other content are resent
+  if (lines > 0) {
+    top = oled->win_y + SH1106_RAM_HEIGHT - lines;
+    bottom = oled->win_y + SH1106_RAM_HEIGHT - 1;
+  } else {
+    top = oled->win_y;
+    bottom = oled->win_y - lines - 1;
+  }
+  if (top < oled->win_y)
+    top = oled->win_y;
+  if (bottom >= oled->canvas.height)
+    bottom = oled->canvas.height - 1;
+  if (top <= bottom)
+    _mark_dirty (&oled->canvas, 0, top, oled->canvas.width - 1, bottom);
+  oled->canvas.refresh_left = 0;
+  oled->canvas.refresh_right = oled->canvas.width - 1;
+}
+
+uint8_t mgos_sh1106_get_start_line (struct mgos_sh1106 *oled)
+{
+  if (oled == NULL)
+    return 0;
+
+  return _start_line (oled);
+}
+
+void mgos_sh1106_set_viewport (struct mgos_sh1106 *oled, uint16_t x, uint16_t y)
+{
+  int32_t win_y;
+
+  if (oled == NULL)
+    return;
+
+  if (x > oled->canvas.width - oled->width)
+    x = oled->canvas.width - oled->width;
+  if (oled->canvas.height == SH1106_RAM_HEIGHT)
+    y &= SH1106_RAM_HEIGHT - 1;       // canvas is the RAM ring, let it wrap
+  else if (y > oled->canvas.height - oled->height)
+    y = oled->canvas.height - oled->height;
+
+  // The controller has no column start register, so a horizontal move
+  // invalidates every RAM page; a vertical one is just the start line.
+  if (x != oled->view_x) {
+    oled->view_x = x;
+    oled->stale_pages = 0xff;
+  }
+
+  // Slide the RAM window over a tall canvas just enough to hold the view;
+  // RAM rows taken over by newly cached canvas rows go stale.
+  if (oled->canvas.height > SH1106_RAM_HEIGHT) {
+    win_y = oled->win_y;
+    if (y < win_y)
+      win_y = y;
+    else if (y + oled->height > win_y + SH1106_RAM_HEIGHT)
+      win_y = y + oled->height - SH1106_RAM_HEIGHT;
+    if (win_y < oled->win_y)
+      _mark_stale_rows (oled, win_y, (oled->win_y - 1 < win_y + SH1106_RAM_HEIGHT - 1) ? oled->win_y - 1 : win_y + SH1106_RAM_HEIGHT - 1);
+    else if (win_y > oled->win_y)
+      _mark_stale_rows (oled, (oled->win_y + SH1106_RAM_HEIGHT > win_y) ? oled->win_y + SH1106_RAM_HEIGHT : win_y, win_y + SH1106_RAM_HEIGHT - 1);
+    oled->win_y = win_y;
+  }
+
+  if (y != oled->view_y) {
+    oled->view_y = y;
+    _command (oled, SH1106_SETSTARTLINE | _start_line (oled));
+  }
+
+  for (uint8_t page = 0; page < SH1106_RAM_HEIGHT / 8; ++page) {
+    if (_visible_pages (oled) & oled->stale_pages & (1 << page)) {
+      _write_ram_page (oled, page, 0, oled->canvas.width - 1);
+      oled->stale_pages &= ~(1 << page);
+    }
+  }
+}
+
+void mgos_sh1106_pan (struct mgos_sh1106 *oled, int16_t dx, int16_t dy)
+{
+  int32_t x, y;
+
+  if (oled == NULL)
+    return;
+
+  x = oled->view_x + dx;
+  y = oled->view_y + dy;
+  if (x < 0)
+    x = 0;
+  if (oled->canvas.height == SH1106_RAM_HEIGHT)
+    y &= SH1106_RAM_HEIGHT - 1;
+  else if (y < 0)
+    y = 0;
+  mgos_sh1106_set_viewport (oled, x, y);
+}
+
+uint16_t mgos_sh1106_get_viewport_x (struct mgos_sh1106 *oled)
+{
+  if (oled == NULL)
+    return 0;
+
+  return oled->view_x;
+}
+
+uint16_t mgos_sh1106_get_viewport_y (struct mgos_sh1106 *oled)
+{
+  if (oled == NULL)
+    return 0;
+
+  return oled->view_y;
+}
+
+bool mgos_sh1106_set_canvas (struct mgos_sh1106 *oled, uint16_t width, uint16_t height)
+{
+  uint8_t *buffer;
+
+  if (oled == NULL)
+    return false;
+
+  // fixed geometry builds rely on the canvas being the controller RAM
+  if (SH1106_FIXED_GEOMETRY)
+    return false;
+
+  height = (height + 7) & ~7;
+  if (width < oled->width || height < oled->height)
+    return false;
+  if (oled->canvas.gray != NULL) {
+    LOG (LL_WARN, ("SH1106 gray mode is off after a canvas change"));
+    mgos_sh1106_set_gray_mode (oled, false, 0);
+  }
+
+  buffer = sh1106_alloc ((size_t) width * (height / 8));
+  if (buffer == NULL) {
+    LOG (LL_ERROR, ("SH1106 canvas %ux%u allocation failed", width, height));
+    return false;
+  }
+  if (oled->owns_canvas)
+    sh1106_release (oled->canvas.buffer);
+  oled->canvas.buffer = buffer;
+  oled->owns_canvas = true;
+  oled->canvas.width = width;
+  oled->canvas.height = height;
+  oled->view_x = 0;
+  oled->view_y = 0;
+  oled->win_y = 0;
+  oled->row_base = 0;
+  oled->stale_pages = 0xff;
+  _command (oled, SH1106_SETSTARTLINE | _start_line (oled));
+  _reset_dirty (&oled->canvas);
+  return true;
+}
+
+uint16_t mgos_sh1106_get_canvas_width (struct mgos_sh1106 *oled)
+{
+  if (oled == NULL)
+    return 0;
+
+  return oled->canvas.width;
+}
+
+uint16_t mgos_sh1106_get_canvas_height (struct mgos_sh1106 *oled)
+{
+  if (oled == NULL)
+    return 0;
+
+  return oled->canvas.height;
+}
+
+static ALWAYS_INLINE void _draw_pixel (struct mgos_sh1106_surface *s, const uint16_t width, const uint16_t height,
+                                     int16_t x, int16_t y, mgos_sh1106_color_t color)
+{
+  size_t index;
+
+
+  if ((x >= width) || (x < 0) || (y >= height) || (y < 0))
+    return;
+
+  index = x + (y / 8) * width;
+  _gray_bits (s, index, 1 << (y & 7), color);
+  switch (_mono (color)) {
   case SH1106_COLOR_WHITE:
-    oled->buffer[index] |= (1 << (y & 7));
+    s->buffer[index] |= (1 << (y & 7));
     break;
   case SH1106_COLOR_BLACK:
-    oled->buffer[index] &= ~(1 << (y & 7));
+    s->buffer[index] &= ~(1 << (y & 7));
     break;
   case SH1106_COLOR_INVERT:
-    oled->buffer[index] ^= (1 << (y & 7));
+    s->buffer[index] ^= (1 << (y & 7));
     break;
   default:
     break;
   }
-  if (oled->refresh_left > x)
-    oled->refresh_left = x;
-  if (oled->refresh_right < x)
-    oled->refresh_right = x;
-  if (oled->refresh_top > y)
-    oled->refresh_top = y;
-  if (oled->refresh_bottom < y)
-    oled->refresh_bottom = y;
+  _mark_dirty (s, x, y, x, y);
 }
 
-void mgos_sh1106_draw_hline (struct mgos_sh1106 *oled, int8_t x, int8_t y, uint8_t w, mgos_sh1106_color_t color)
+void mgos_sh1106_draw_pixel (struct mgos_sh1106 *oled, int16_t x, int16_t y, mgos_sh1106_color_t color)
 {
-  uint16_t UNUSED (index);
-  uint8_t mask, t;
-
   if (oled == NULL)
     return;
+
+  _WITH_GEOMETRY (oled, _draw_pixel, x, y, color);
+}
+
+static ALWAYS_INLINE void _draw_hline (struct mgos_sh1106_surface *s, const uint16_t width, const uint16_t height,
+                                     int16_t x, int16_t y, uint16_t w, mgos_sh1106_color_t color)
+{
+  size_t index;
+  uint8_t mask;
+  uint16_t t;
+
   // boundary check
-  if ((x >= oled->width) || (x < 0) || (y >= oled->height) || (y < 0))
+  if ((x >= width) || (x < 0) || (y >= height) || (y < 0))
     return;
   if (w == 0)
     return;
-  if (x + w > oled->width)
-    w = oled->width - x;
+  if (x + w > width)
+    w = width - x;
 
   t = w;
-  index = x + (y / 8) * oled->width;
+  index = x + (y / 8) * width;
   mask = 1 << (y & 7);
-  switch (color) {
+  if (s->gray != NULL)
+    while (t--)
+      _gray_bits (s, index + t, mask, color);
+  t = w;
+  switch (_mono (color)) {
   case SH1106_COLOR_WHITE:
     while (t--) {
-      oled->buffer[index] |= mask;
+      s->buffer[index] |= mask;
       ++index;
     }
     break;
   case SH1106_COLOR_BLACK:
     mask = ~mask;
     while (t--) {
-      oled->buffer[index] &= mask;
+      s->buffer[index] &= mask;
       ++index;
     }
     break;
   case SH1106_COLOR_INVERT:
     while (t--) {
-      oled->buffer[index] ^= mask;
+      s->buffer[index] ^= mask;
       ++index;
     }
     break;
   default:
     break;
   }
-  if (oled->refresh_left > x)
-    oled->refresh_left = x;
-  if (oled->refresh_right < x + w - 1)
-    oled->refresh_right = x + w - 1;
-  if (oled->refresh_top > y)
-    oled->refresh_top = y;
-  if (oled->refresh_bottom < y)
-    oled->refresh_bottom = y;
+  _mark_dirty (s, x, y, x + w - 1, y);
 }
 
-void mgos_sh1106_draw_vline (struct mgos_sh1106 *oled, int8_t x, int8_t y, uint8_t h, mgos_sh1106_color_t color)
+void mgos_sh1106_draw_hline (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint16_t w, mgos_sh1106_color_t color)
 {
-  uint16_t UNUSED (index);
-  uint8_t mask, mod, t;
-
   if (oled == NULL)
     return;
+
+  _WITH_GEOMETRY (oled, _draw_hline, x, y, w, color);
+}
+
+static ALWAYS_INLINE void _draw_vline (struct mgos_sh1106_surface *s, const uint16_t width, const uint16_t height,
+                                     int16_t x, int16_t y, uint16_t h, mgos_sh1106_color_t color)
+{
+  size_t index;
+  uint8_t mask, mod;
+  uint16_t t;
+
   // boundary check
-  if ((x >= oled->width) || (x < 0) || (y >= oled->height) || (y < 0))
+  if ((x >= width) || (x < 0) || (y >= height) || (y < 0))
     return;
   if (h == 0)
     return;
-  if (y + h > oled->height)
-    h = oled->height - y;
+  if (y + h > height)
+    h = height - y;
 
   t = h;
-  index = x + (y / 8) * oled->width;
+  index = x + (y / 8) * width;
   mod = y & 7;
   if (mod)                      // partial line that does not fit into byte at top
   {
@@ -404,15 +1112,16 @@ void mgos_sh1106_draw_vline (struct mgos_sh1106 *oled, int8_t x, int8_t y, uint8
     mask = premask[mod];
     if (t < mod)
       mask &= (0xFF >> (mod - t));
-    switch (color) {
+    _gray_bits (s, index, mask, color);
+    switch (_mono (color)) {
     case SH1106_COLOR_WHITE:
-      oled->buffer[index] |= mask;
+      s->buffer[index] |= mask;
       break;
     case SH1106_COLOR_BLACK:
-      oled->buffer[index] &= ~mask;
+      s->buffer[index] &= ~mask;
       break;
     case SH1106_COLOR_INVERT:
-      oled->buffer[index] ^= mask;
+      s->buffer[index] ^= mask;
       break;
     default:
       break;
@@ -420,31 +1129,34 @@ void mgos_sh1106_draw_vline (struct mgos_sh1106 *oled, int8_t x, int8_t y, uint8
     if (t < mod)
       goto draw_vline_finish;
     t -= mod;
-    index += oled->width;
+    index += width;
   }
   if (t >= 8)                   // byte aligned line at middle
   {
-    switch (color) {
+    if (s->gray != NULL)
+      for (size_t i = index, n = t; n >= 8; i += width, n -= 8)
+        _gray_bits (s, i, 0xff, color);
+    switch (_mono (color)) {
     case SH1106_COLOR_WHITE:
       do {
-        oled->buffer[index] = 0xff;
-        index += oled->width;
+        s->buffer[index] = 0xff;
+        index += width;
         t -= 8;
       }
       while (t >= 8);
       break;
     case SH1106_COLOR_BLACK:
       do {
-        oled->buffer[index] = 0x00;
-        index += oled->width;
+        s->buffer[index] = 0x00;
+        index += width;
         t -= 8;
       }
       while (t >= 8);
       break;
     case SH1106_COLOR_INVERT:
       do {
-        oled->buffer[index] = ~oled->buffer[index];
-        index += oled->width;
+        s->buffer[index] = ~s->buffer[index];
+        index += width;
         t -= 8;
       }
       while (t >= 8);
@@ -458,33 +1170,35 @@ void mgos_sh1106_draw_vline (struct mgos_sh1106 *oled, int8_t x, int8_t y, uint8
     mod = t & 7;
     static const uint8_t postmask[8] = { 0x00, 0x01, 0x03, 0x07, 0x0F, 0x1F, 0x3F, 0x7F };
     mask = postmask[mod];
-    switch (color) {
+    _gray_bits (s, index, mask, color);
+    switch (_mono (color)) {
     case SH1106_COLOR_WHITE:
-      oled->buffer[index] |= mask;
+      s->buffer[index] |= mask;
       break;
     case SH1106_COLOR_BLACK:
-      oled->buffer[index] &= ~mask;
+      s->buffer[index] &= ~mask;
       break;
     case SH1106_COLOR_INVERT:
-      oled->buffer[index] ^= mask;
+      s->buffer[index] ^= mask;
       break;
     default:
       break;
     }
   }
 draw_vline_finish:
-  if (oled->refresh_left > x)
-    oled->refresh_left = x;
-  if (oled->refresh_right < x)
-    oled->refresh_right = x;
-  if (oled->refresh_top > y)
-    oled->refresh_top = y;
-  if (oled->refresh_bottom < y + h - 1)
-    oled->refresh_bottom = y + h - 1;
+  _mark_dirty (s, x, y, x, y + h - 1);
   return;
 }
 
-void mgos_sh1106_draw_rectangle (struct mgos_sh1106 *oled, int8_t x, int8_t y, uint8_t w, uint8_t h, mgos_sh1106_color_t color)
+void mgos_sh1106_draw_vline (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint16_t h, mgos_sh1106_color_t color)
+{
+  if (oled == NULL)
+    return;
+
+  _WITH_GEOMETRY (oled, _draw_vline, x, y, h, color);
+}
+
+void mgos_sh1106_draw_rectangle (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h, mgos_sh1106_color_t color)
 {
   mgos_sh1106_draw_hline (oled, x, y, w, color);
   mgos_sh1106_draw_hline (oled, x, y + h - 1, w, color);
@@ -492,46 +1206,44 @@ void mgos_sh1106_draw_rectangle (struct mgos_sh1106 *oled, int8_t x, int8_t y, u
   mgos_sh1106_draw_vline (oled, x + w - 1, y, h, color);
 }
 
-void mgos_sh1106_fill_rectangle (struct mgos_sh1106 *oled, int8_t x, int8_t y, uint8_t w, uint8_t h, mgos_sh1106_color_t color)
+void mgos_sh1106_fill_rectangle (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h, mgos_sh1106_color_t color)
 {
   // Can be optimized?
-  uint8_t i;
+  int16_t i;
   for (i = x; i < x + w; ++i)
     mgos_sh1106_draw_vline (oled, i, y, h, color);
 }
 
-void mgos_sh1106_draw_circle (struct mgos_sh1106 *oled, int8_t x0, int8_t y0, uint8_t r, mgos_sh1106_color_t color)
+static ALWAYS_INLINE void _draw_circle (struct mgos_sh1106_surface *s, const uint16_t width, const uint16_t height,
+                                      int16_t x0, int16_t y0, uint16_t r, mgos_sh1106_color_t color)
 {
   // Refer to http://en.wikipedia.org/wiki/Midpoint_circle_algorithm for the algorithm
 
-  int8_t x = r;
-  int8_t y = 1;
+  int16_t x = r;
+  int16_t y = 1;
   int16_t radius_err = 1 - x;
 
-  if (oled == NULL)
-    return;
-
   if (r == 0)
     return;
 
-  mgos_sh1106_draw_pixel (oled, x0 - r, y0, color);
-  mgos_sh1106_draw_pixel (oled, x0 + r, y0, color);
-  mgos_sh1106_draw_pixel (oled, x0, y0 - r, color);
-  mgos_sh1106_draw_pixel (oled, x0, y0 + r, color);
+  _draw_pixel (s, width, height, x0 - r, y0, color);
+  _draw_pixel (s, width, height, x0 + r, y0, color);
+  _draw_pixel (s, width, height, x0, y0 - r, color);
+  _draw_pixel (s, width, height, x0, y0 + r, color);
 
   while (x >= y) {
-    mgos_sh1106_draw_pixel (oled, x0 + x, y0 + y, color);
-    mgos_sh1106_draw_pixel (oled, x0 - x, y0 + y, color);
-    mgos_sh1106_draw_pixel (oled, x0 + x, y0 - y, color);
-    mgos_sh1106_draw_pixel (oled, x0 - x, y0 - y, color);
+    _draw_pixel (s, width, height, x0 + x, y0 + y, color);
+    _draw_pixel (s, width, height, x0 - x, y0 + y, color);
+    _draw_pixel (s, width, height, x0 + x, y0 - y, color);
+    _draw_pixel (s, width, height, x0 - x, y0 - y, color);
     if (x != y) {
       /* Otherwise the 4 drawings below are the same as above, causing
        * problem when color is INVERT
        */
-      mgos_sh1106_draw_pixel (oled, x0 + y, y0 + x, color);
-      mgos_sh1106_draw_pixel (oled, x0 - y, y0 + x, color);
-      mgos_sh1106_draw_pixel (oled, x0 + y, y0 - x, color);
-      mgos_sh1106_draw_pixel (oled, x0 - y, y0 - x, color);
+      _draw_pixel (s, width, height, x0 + y, y0 + x, color);
+      _draw_pixel (s, width, height, x0 - y, y0 + x, color);
+      _draw_pixel (s, width, height, x0 + y, y0 - x, color);
+      _draw_pixel (s, width, height, x0 - y, y0 - x, color);
     }
     ++y;
     if (radius_err < 0) {
@@ -544,12 +1256,20 @@ void mgos_sh1106_draw_circle (struct mgos_sh1106 *oled, int8_t x0, int8_t y0, ui
   }
 }
 
-void mgos_sh1106_fill_circle (struct mgos_sh1106 *oled, int8_t x0, int8_t y0, uint8_t r, mgos_sh1106_color_t color)
+void mgos_sh1106_draw_circle (struct mgos_sh1106 *oled, int16_t x0, int16_t y0, uint16_t r, mgos_sh1106_color_t color)
+{
+  if (oled == NULL)
+    return;
+
+  _WITH_GEOMETRY (oled, _draw_circle, x0, y0, r, color);
+}
+
+void mgos_sh1106_fill_circle (struct mgos_sh1106 *oled, int16_t x0, int16_t y0, uint16_t r, mgos_sh1106_color_t color)
 {
-  int8_t x = 1;
-  int8_t y = r;
+  int16_t x = 1;
+  int16_t y = r;
   int16_t radius_err = 1 - y;
-  int8_t x1;
+  int16_t x1;
 
   if (oled == NULL)
     return;
@@ -602,37 +1322,31 @@ void mgos_sh1106_select_font (struct mgos_sh1106 *oled, uint8_t font)
 {
   if (oled == NULL)
     return;
-  if (font < NUM_FONTS)
-    oled->font = fonts[font];
+  if (font_get (font) != NULL)
+    oled->font = font_get (font);
 }
 
-// return character width
-uint8_t
-mgos_sh1106_draw_char (struct mgos_sh1106 *oled, uint8_t x, uint8_t y, unsigned char c, mgos_sh1106_color_t foreground, mgos_sh1106_color_t background)
+void mgos_sh1106_set_font (struct mgos_sh1106 *oled, const font_info_t *font)
+{
+  if (oled == NULL || font == NULL)
+    return;
+  oled->font = font;
+}
+
+static ALWAYS_INLINE void _draw_glyph (struct mgos_sh1106_surface *s, const uint16_t width, const uint16_t height,
+                                      int16_t x, int16_t y, const uint8_t *bitmap, uint8_t w, uint8_t h,
+                                      mgos_sh1106_color_t foreground, mgos_sh1106_color_t background)
 {
   uint8_t i, j;
-  const uint8_t UNUSED (*bitmap);
   uint8_t line = 0;
 
-  if (oled == NULL)
-    return 0;
-
-  if (oled->font == NULL)
-    return 0;
-
-  LOG (LL_INFO, ("Drawing %c at %d,%d", c, x, y));
-  // we always have space in the font set
-  if ((c < oled->font->char_start) || (c > oled->font->char_end))
-    c = ' ';
-  c = c - oled->font->char_start;       // c now become index to tables
-  bitmap = oled->font->bitmap + oled->font->char_descriptors[c].offset;
-  for (j = 0; j < oled->font->height; ++j) {
-    for (i = 0; i < oled->font->char_descriptors[c].width; ++i) {
+  for (j = 0; j < h; ++j) {
+    for (i = 0; i < w; ++i) {
       if (i % 8 == 0) {
-        line = bitmap[(oled->font->char_descriptors[c].width + 7) / 8 * j + i / 8];     // line data
+        line = bitmap[(w + 7) / 8 * j + i / 8];        // line data
       }
       if (line & 0x80) {
-        mgos_sh1106_draw_pixel (oled, x + i, y + j, foreground);
+        _draw_pixel (s, width, height, x + i, y + j, foreground);
       } else {
         switch (background) {
         case SH1106_COLOR_TRANSPARENT:
@@ -640,7 +1354,9 @@ mgos_sh1106_draw_char (struct mgos_sh1106 *oled, uint8_t x, uint8_t y, unsigned
           break;
         case SH1106_COLOR_WHITE:
         case SH1106_COLOR_BLACK:
-          mgos_sh1106_draw_pixel (oled, x + i, y + j, background);
+        case SH1106_COLOR_DARK_GRAY:
+        case SH1106_COLOR_LIGHT_GRAY:
+          _draw_pixel (s, width, height, x + i, y + j, background);
           break;
         case SH1106_COLOR_INVERT:
           // I don't know why I need invert background
@@ -650,13 +1366,46 @@ mgos_sh1106_draw_char (struct mgos_sh1106 *oled, uint8_t x, uint8_t y, unsigned
       line = line << 1;
     }
   }
-  return (oled->font->char_descriptors[c].width);
+}
+
+// return character width
+uint8_t
+mgos_sh1106_draw_codepoint (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint32_t cp, mgos_sh1106_color_t foreground, mgos_sh1106_color_t background)
+{
+  const uint8_t *bitmap;
+  int32_t glyph;
+  uint8_t width;
+
+  if (oled == NULL)
+    return 0;
+
+  if (oled->font == NULL)
+    return 0;
+
+  LOG (LL_VERBOSE_DEBUG, ("Drawing U+%04X at %d,%d", (unsigned) cp, x, y));
+  glyph = font_lookup_glyph (oled->font, cp);
+  if (glyph < 0)
+    return 0;
+  width = font_glyph_width (oled->font, glyph);
+  bitmap = font_get_glyph (oled->font, glyph);
+  if (bitmap != NULL)
+    _WITH_GEOMETRY (oled, _draw_glyph, x, y, bitmap, width, oled->font->height, foreground, background);
+  else
+    LOG (LL_ERROR, ("Glyph %d does not fit the glyph cache", (int) glyph));
+  return width;
 }
 
 uint8_t
-mgos_sh1106_draw_string_color (struct mgos_sh1106 * oled, uint8_t x, uint8_t y, char *str, mgos_sh1106_color_t foreground, mgos_sh1106_color_t background)
+mgos_sh1106_draw_char (struct mgos_sh1106 *oled, int16_t x, int16_t y, unsigned char c, mgos_sh1106_color_t foreground, mgos_sh1106_color_t background)
+{
+  return mgos_sh1106_draw_codepoint (oled, x, y, c, foreground, background);
+}
+
+uint16_t
+mgos_sh1106_draw_string_color (struct mgos_sh1106 * oled, int16_t x, int16_t y, char *str, mgos_sh1106_color_t foreground, mgos_sh1106_color_t background)
 {
-  uint8_t t = x;
+  const char *p = str;
+  int16_t t = x;
 
   if (oled == NULL)
     return 0;
@@ -667,45 +1416,35 @@ mgos_sh1106_draw_string_color (struct mgos_sh1106 * oled, uint8_t x, uint8_t y,
   if (str == NULL)
     return 0;
 
-  while (*str) {
-    x += mgos_sh1106_draw_char (oled, x, y, *str, foreground, background);
-    ++str;
-    if (*str)
+  while (*p) {
+    x += mgos_sh1106_draw_codepoint (oled, x, y, font_next_char (oled->font, &p, NULL), foreground, background);
+    if (*p)
       x += oled->font->c;
   }
 
   return (x - t);
 }
 
-uint8_t mgos_sh1106_draw_string (struct mgos_sh1106 * oled, uint8_t x, uint8_t y, char *str)
+uint16_t mgos_sh1106_draw_string (struct mgos_sh1106 * oled, int16_t x, int16_t y, char *str)
 {
   return mgos_sh1106_draw_string_color (oled, x, y, str, SH1106_COLOR_WHITE, SH1106_COLOR_TRANSPARENT);
 }
 
 // return width of string
-uint8_t mgos_sh1106_measure_string (struct mgos_sh1106 * oled, char *str)
+uint16_t mgos_sh1106_measure_string (struct mgos_sh1106 * oled, char *str)
 {
-  uint8_t w = 0;
-  unsigned char c;
+  return mgos_sh1106_measure_string_n (oled, str, SIZE_MAX);
+}
 
+uint16_t mgos_sh1106_measure_string_n (struct mgos_sh1106 *oled, const char *str, size_t len)
+{
   if (oled == NULL)
     return 0;
 
   if (oled->font == NULL)
     return 0;
 
-  while (*str) {
-    c = *str;
-    // we always have space in the font set
-    if ((c < oled->font->char_start) || (c > oled->font->char_end))
-      c = ' ';
-    c = c - oled->font->char_start;     // c now become index to tables
-    w += oled->font->char_descriptors[c].width;
-    ++str;
-    if (*str)
-      w += oled->font->c;
-  }
-  return w;
+  return font_measure (oled->font, str, len);
 }
 
 uint8_t mgos_sh1106_get_font_height (struct mgos_sh1106 * oled)
@@ -756,21 +1495,302 @@ void mgos_sh1106_flip_display (struct mgos_sh1106 *oled, bool horizontal, bool v
 
 void mgos_sh1106_update_buffer (struct mgos_sh1106 *oled, uint8_t * data, uint16_t length)
 {
+  uint16_t n;
+
+  if (oled == NULL)
+    return;
+
+  // Source is a panel-sized page image; place it at the top-left of the buffer
+  for (uint8_t page = 0; page < oled->height / 8 && length > 0; ++page) {
+    n = (length < oled->width) ? length : oled->width;
+    memcpy (oled->canvas.buffer + page * oled->canvas.width, data, n);
+    if (oled->canvas.gray != NULL)
+      memset (oled->canvas.gray + page * oled->canvas.width, 0, n);
+    data += n;
+    length -= n;
+  }
+  _mark_dirty (&oled->canvas, 0, 0, oled->width - 1, oled->height - 1);
+}
+
+struct mgos_sh1106_surface *mgos_sh1106_surface_create (uint16_t width, uint16_t height)
+{
+  struct mgos_sh1106_surface *surface;
+
+  if (width == 0 || height == 0)
+    return NULL;
+
+  height = (height + 7) & ~7;
+  surface = sh1106_alloc (sizeof (*surface) + (size_t) width * (height / 8));
+  if (surface == NULL)
+    return NULL;
+
+  surface->buffer = (uint8_t *) (surface + 1);
+  surface->width = width;
+  surface->height = height;
+  _reset_dirty (surface);
+  return surface;
+}
+
+void mgos_sh1106_surface_free (struct mgos_sh1106_surface *surface)
+{
+  sh1106_release (surface);
+}
+
+uint16_t mgos_sh1106_surface_get_width (const struct mgos_sh1106_surface *surface)
+{
+  if (surface == NULL)
+    return 0;
+
+  return surface->width;
+}
+
+uint16_t mgos_sh1106_surface_get_height (const struct mgos_sh1106_surface *surface)
+{
+  if (surface == NULL)
+    return 0;
+
+  return surface->height;
+}
+
+void mgos_sh1106_set_target (struct mgos_sh1106 *oled, struct mgos_sh1106_surface *surface)
+{
+  if (oled == NULL)
+    return;
+
+  if (surface == NULL)
+    surface = (oled->rotated != NULL) ? oled->rotated : &oled->canvas;
+  oled->target = surface;
+}
+
+// Move a clipped rectangle within one plane, combining it with what is there
+// by rop and clearing the bits it touches in gray, if given. Pages are
+// visited away from the direction of travel and columns likewise, so every
+// source byte is read before the move overwrites it.
+static void _move_plane (uint8_t *plane, uint16_t width, uint16_t height, int32_t x0, int32_t y0, int32_t x1,
+                         int32_t y1, int32_t cw, int32_t ch, mgos_sh1106_rop_t rop, uint8_t *gray)
+{
+  int32_t first = y1 / 8, last = (y1 + ch - 1) / 8, pages = height / 8;
+  int32_t step = (y1 > y0) ? -1 : 1;
+  int32_t row, end, src_row, src_page, i, di;
+  const uint8_t *a, *b;
+  uint8_t mask, shift, v, *d, *g;
+
+  for (int32_t p = (step > 0) ? first : last; p >= first && p <= last; p += step) {
+    row = (y1 > p * 8) ? y1 : p * 8;
+    end = (y1 + ch < p * 8 + 8) ? y1 + ch : p * 8 + 8;
+    mask = (0xff >> (8 - (end - row))) << (row & 7);
+    d = plane + p * width + x1;
+    g = (gray != NULL) ? gray + p * width + x1 : NULL;
+
+    // the source rows under this destination page: the bottom of page a
+    // shifted up, carrying in the top of page b
+    src_row = y0 + p * 8 - y1;
+    src_page = src_row >> 3;
+    shift = src_row & 7;
+    a = (src_page >= 0 && src_page < pages) ? plane + src_page * width + x0 : NULL;
+    b = (shift && src_page + 1 < pages) ? plane + (src_page + 1) * width + x0 : NULL;
+
+    if (mask == 0xff && shift == 0 && rop == SH1106_ROP_COPY) {
+      memmove (d, a, cw);
+      if (g != NULL)
+        memset (g, 0, cw);
+      continue;
+    }
+    i = (x1 > x0) ? cw - 1 : 0;
+    di = (x1 > x0) ? -1 : 1;
+    if (a != NULL && b != NULL) {
+      for (int32_t k = 0; k < cw; ++k, i += di) {
+        v = (a[i] >> shift) | (b[i] << (8 - shift));
+        _rop_bits (d + i, v, mask, rop);
+        if (g != NULL)
+          g[i] &= ~_rop_touched (v, mask, rop);
+      }
+      continue;
+    }
+    for (int32_t k = 0; k < cw; ++k, i += di) {
+      v = (a != NULL) ? a[i] >> shift : 0;
+      if (b != NULL)
+        v |= b[i] << (8 - shift);
+      _rop_bits (d + i, v, mask, rop);
+      if (g != NULL)
+        g[i] &= ~_rop_touched (v, mask, rop);
+    }
+  }
+}
+
+void mgos_sh1106_blit (struct mgos_sh1106 *oled, const struct mgos_sh1106_surface *src, int16_t sx, int16_t sy,
+                       uint16_t w, uint16_t h, int16_t dx, int16_t dy, mgos_sh1106_rop_t rop)
+{
+  struct mgos_sh1106_surface *dst;
+  int32_t x0 = sx, y0 = sy, x1 = dx, y1 = dy, cw = w, ch = h;
+  int32_t row, src_row;
+  uint8_t top, n, mask, v;
+  uint8_t *d, *g;
+
+  if (oled == NULL || src == NULL)
+    return;
+  dst = oled->target;
+
+  // clip against the source, then the destination
+  if (x0 < 0) {
+    cw += x0;
+    x1 -= x0;
+    x0 = 0;
+  }
+  if (y0 < 0) {
+    ch += y0;
+    y1 -= y0;
+    y0 = 0;
+  }
+  if (x1 < 0) {
+    cw += x1;
+    x0 -= x1;
+    x1 = 0;
+  }
+  if (y1 < 0) {
+    ch += y1;
+    y0 -= y1;
+    y1 = 0;
+  }
+  if (x0 + cw > src->width)
+    cw = src->width - x0;
+  if (y0 + ch > src->height)
+    ch = src->height - y0;
+  if (x1 + cw > dst->width)
+    cw = dst->width - x1;
+  if (y1 + ch > dst->height)
+    ch = dst->height - y1;
+  if (cw <= 0 || ch <= 0)
+    return;
+
+  // within one surface the areas may overlap: move in a safe order
+  if (src == dst) {
+    // a copy takes the gray levels along, other operations clear what they touch
+    if (dst->gray != NULL && rop == SH1106_ROP_COPY)
+      _move_plane (dst->gray, dst->width, dst->height, x0, y0, x1, y1, cw, ch, rop, NULL);
+    _move_plane (dst->buffer, dst->width, dst->height, x0, y0, x1, y1, cw, ch, rop,
+                 (rop == SH1106_ROP_COPY) ? NULL : dst->gray);
+    _mark_dirty (dst, x1, y1, x1 + cw - 1, y1 + ch - 1);
+    return;
+  }
+
+  // One destination page at a time; source rows are stitched when the
+  // two surfaces are not page aligned with each other.
+  for (row = y1; row < y1 + ch; row += n) {
+    top = row & 7;
+    n = (8 - top < y1 + ch - row) ? 8 - top : y1 + ch - row;
+    mask = (0xff >> (8 - n)) << top;
+    src_row = y0 + (row - top - y1);
+    d = dst->buffer + (row / 8) * dst->width + x1;
+    g = (dst->gray != NULL) ? dst->gray + (row / 8) * dst->width + x1 : NULL;
+
+    if (mask == 0xff && rop == SH1106_ROP_COPY && (src_row & 7) == 0) {
+      memcpy (d, src->buffer + (src_row / 8) * src->width + x0, cw);
+      if (g != NULL)
+        memset (g, 0, cw);
+      continue;
+    }
+    for (int32_t i = 0; i < cw; ++i) {
+      v = _surface_rows8 (src, x0 + i, src_row);
+      _rop_bits (d + i, v, mask, rop);
+      if (g != NULL)
+        g[i] &= ~_rop_touched (v, mask, rop);
+    }
+  }
+  _mark_dirty (dst, x1, y1, x1 + cw - 1, y1 + ch - 1);
+}
+
+void mgos_sh1106_copy_rect (struct mgos_sh1106 *oled, int16_t sx, int16_t sy, uint16_t w, uint16_t h, int16_t dx,
+                            int16_t dy, mgos_sh1106_color_t fill)
+{
+  struct mgos_sh1106_surface *s;
+  int32_t left = sx, top = sy, right = sx + w, bottom = sy + h;
+  int32_t x0, y0, x1, y1, cw, ch, mid_top, mid_bottom;
+
   if (oled == NULL)
     return;
+  s = oled->target;
+
+  // the source clipped to the surface, which is also the exposed area
+  if (left < 0)
+    left = 0;
+  if (top < 0)
+    top = 0;
+  if (right > s->width)
+    right = s->width;
+  if (bottom > s->height)
+    bottom = s->height;
+  if (left >= right || top >= bottom)
+    return;
+
+  // then its destination
+  x0 = left;
+  y0 = top;
+  x1 = dx + (left - sx);
+  y1 = dy + (top - sy);
+  cw = right - left;
+  ch = bottom - top;
+  if (x1 < 0) {
+    cw += x1;
+    x0 -= x1;
+    x1 = 0;
+  }
+  if (y1 < 0) {
+    ch += y1;
+    y0 -= y1;
+    y1 = 0;
+  }
+  if (x1 + cw > s->width)
+    cw = s->width - x1;
+  if (y1 + ch > s->height)
+    ch = s->height - y1;
+  if (cw <= 0 || ch <= 0) {
+    // nothing lands on the surface: all of the source is exposed
+    x1 = y1 = cw = ch = 0;
+  } else if (x0 != x1 || y0 != y1) {
+    _move_plane (s->buffer, s->width, s->height, x0, y0, x1, y1, cw, ch, SH1106_ROP_COPY, NULL);
+    if (s->gray != NULL)
+      _move_plane (s->gray, s->width, s->height, x0, y0, x1, y1, cw, ch, SH1106_ROP_COPY, NULL);
+    _mark_dirty (s, x1, y1, x1 + cw - 1, y1 + ch - 1);
+  } else {
+    return;
+  }
+  if (fill == SH1106_COLOR_TRANSPARENT)
+    return;
 
-  memcpy (oled->buffer, data, (length < (oled->width * oled->height / 8)) ? length : (oled->width * oled->height / 8));
-  oled->refresh_right = oled->width - 1;
-  oled->refresh_bottom = oled->height - 1;
-  oled->refresh_top = 0;
-  oled->refresh_left = 0;
+  // Fill what the destination does not cover: the source rows above and
+  // below it, then the columns beside it
+  mid_top = (top > y1) ? top : y1;
+  mid_bottom = (bottom < y1 + ch) ? bottom : y1 + ch;
+  if (mid_top >= mid_bottom) {
+    mgos_sh1106_fill_rectangle (oled, left, top, right - left, bottom - top, fill);
+    return;
+  }
+  if (top < mid_top)
+    mgos_sh1106_fill_rectangle (oled, left, top, right - left, mid_top - top, fill);
+  if (bottom > mid_bottom)
+    mgos_sh1106_fill_rectangle (oled, left, mid_bottom, right - left, bottom - mid_bottom, fill);
+  if (left < x1)
+    mgos_sh1106_fill_rectangle (oled, left, mid_top, ((right < x1) ? right : x1) - left, mid_bottom - mid_top, fill);
+  if (right > x1 + cw) {
+    x0 = (left > x1 + cw) ? left : x1 + cw;
+    mgos_sh1106_fill_rectangle (oled, x0, mid_top, right - x0, mid_bottom - mid_top, fill);
+  }
 }
 
 bool mgos_sh1106_init (void)
 {
   if (!mgos_sys_config_get_sh1106_enable ())
     return true;
+#if SH1106_STATIC_ALLOC
+  s_global_sh1106 = mgos_sh1106_create_static (mgos_sys_config_get_sh1106 (), &s_global_storage);
+#else
   s_global_sh1106 = mgos_sh1106_create (mgos_sys_config_get_sh1106 ());
+#endif
+#if SH1106_LATENCY_STATS && MGOS_HAVE_RPC_COMMON
+  if (s_global_sh1106 != NULL && !sh1106_latency_rpc_init ())
+    LOG (LL_ERROR, ("SH1106 latency RPC registration failed"));
+#endif
   return (s_global_sh1106 != NULL);
 }
 
@@ -0,0 +1,468 @@
+/*
+ * Streaming 1-bpp image decoders: PBM (P1/P4), XBM and uncompressed BMP.
+ *
+ * Input is accepted in chunks of any size. Pixels are collected in a band
+ * covering one destination page of the visible image columns and painted
+ * into the draw target when the image moves on to another page.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/cs_dbg.h"
+
+#include "sh1106.h"
+#include "sh1106_internal.h"
+
+enum sh1106_image_state
+{
+  IMAGE_MAGIC,                  // PBM "P1" / "P4"
+  IMAGE_PBM_HEADER,             // width and height
+  IMAGE_PBM_ASCII,
+  IMAGE_PBM_RAW,
+  IMAGE_XBM_HEADER,             // #defines up to the opening brace
+  IMAGE_XBM_DATA,
+  IMAGE_BMP_HEADER,             // headers and palette up to the pixel data
+  IMAGE_BMP_DATA,
+  IMAGE_DONE,
+  IMAGE_ERROR,
+};
+
+#define BMP_HEADER_SIZE 54      // file header and BITMAPINFOHEADER
+
+struct mgos_sh1106_image_decoder
+{
+  struct mgos_sh1106_surface *s;        // target when decoding began
+  int16_t x;                    // destination of the image's top-left pixel
+  int16_t y;
+  mgos_sh1106_color_t foreground;       // set (ink) pixels
+  mgos_sh1106_color_t background;       // clear pixels
+  enum sh1106_image_state state;
+  uint16_t width;
+  uint16_t height;
+  uint16_t row;                 // next pixel, in input order
+  uint16_t col;
+  uint8_t row_bit;              // band bit of the current row, 0 if clipped
+  uint8_t band_rows;            // rows of band_page present in the band
+  int32_t band_page;            // destination page the band holds
+  uint16_t vis_left;            // image columns inside the target
+  uint16_t vis_right;
+  uint8_t *band;                // vis_right - vis_left + 1 bytes, NULL if none visible
+  // text formats
+  uint32_t num;
+  uint8_t field;                // header numbers read so far
+  bool in_num;
+  bool comment;
+  bool raw;                     // PBM P4
+  char tok[32];                 // last characters of the current XBM token
+  uint8_t tok_len;
+  // BMP
+  uint32_t pos;                 // input bytes consumed
+  uint8_t hdr[BMP_HEADER_SIZE];
+  uint8_t palette[8];
+  uint8_t invert;               // xor turning data bits into ink bits
+  bool bottom_up;
+  uint16_t pad;                 // padding bytes at the end of each row
+  uint16_t pad_left;
+};
+
+// Paint the band into its destination page
+static void _flush_band (struct mgos_sh1106_image_decoder *d)
+{
+  struct mgos_sh1106_surface *s = d->s;
+  uint8_t mask = d->band_rows;
+  size_t index;
+  uint8_t bits;
+
+  if (mask == 0 || d->band == NULL)
+    return;
+
+  if (d->band_page >= 0 && d->band_page < s->height / 8) {
+    index = d->band_page * s->width + d->x + d->vis_left;
+    for (uint16_t c = 0; c <= d->vis_right - d->vis_left; ++c, ++index) {
+      bits = d->band[c];
+      _paint_bits (s, index, bits & mask, d->foreground);
+      _paint_bits (s, index, ~bits & mask, d->background);
+    }
+    _mark_dirty (s, d->x + d->vis_left, d->band_page * 8, d->x + d->vis_right,
+                 (d->band_page * 8 + 7 < s->height) ? d->band_page * 8 + 7 : s->height - 1);
+  }
+  memset (d->band, 0, d->vis_right - d->vis_left + 1);
+  d->band_rows = 0;
+}
+
+static void _start_row (struct mgos_sh1106_image_decoder *d)
+{
+  int32_t dy = d->y + (d->bottom_up ? d->height - 1 - d->row : d->row);
+  int32_t page = (dy - (dy & 7)) / 8;
+
+  d->col = 0;
+  d->row_bit = 0;
+  if (dy < 0 || dy >= d->s->height || d->band == NULL)
+    return;
+  if (page != d->band_page) {
+    _flush_band (d);
+    d->band_page = page;
+  }
+  d->row_bit = 1 << (dy & 7);
+  d->band_rows |= d->row_bit;
+}
+
+// Header parsed: allocate the band for the visible columns and start row 0
+static bool _begin_pixels (struct mgos_sh1106_image_decoder *d, enum sh1106_image_state next)
+{
+  int32_t left = (d->x < 0) ? -d->x : 0;
+  int32_t right = (d->x + d->width > d->s->width) ? d->s->width - d->x - 1 : d->width - 1;
+
+  if (d->width == 0 || d->height == 0)
+    return false;
+  if (left <= right) {
+    d->vis_left = left;
+    d->vis_right = right;
+    d->band = sh1106_alloc (right - left + 1);
+    if (d->band == NULL) {
+      LOG (LL_ERROR, ("SH1106 image band allocation failed"));
+      return false;
+    }
+  }
+  d->state = next;
+  _start_row (d);
+  return true;
+}
+
+// Feed n (1..8) pixels of the current row from the top bits of bits, set bits are ink
+static void _pixels (struct mgos_sh1106_image_decoder *d, uint8_t bits, uint8_t n)
+{
+  uint16_t c;
+
+  if (d->row_bit) {
+    for (uint8_t i = 0; i < n && bits; ++i, bits <<= 1) {
+      c = d->col + i;
+      if ((bits & 0x80) && c >= d->vis_left && c <= d->vis_right)
+        d->band[c - d->vis_left] |= d->row_bit;
+    }
+  }
+  d->col += n;
+  if (d->col < d->width)
+    return;
+  if (++d->row == d->height) {
+    _flush_band (d);
+    d->state = IMAGE_DONE;
+    return;
+  }
+  _start_row (d);
+}
+
+// Pixels left in the current row, at most 8
+static inline uint8_t _byte_pixels (struct mgos_sh1106_image_decoder *d)
+{
+  return (d->width - d->col < 8) ? d->width - d->col : 8;
+}
+
+static inline uint8_t _reverse_bits (uint8_t b)
+{
+  b = (b & 0xf0) >> 4 | (b & 0x0f) << 4;
+  b = (b & 0xcc) >> 2 | (b & 0x33) << 2;
+  return (b & 0xaa) >> 1 | (b & 0x55) << 1;
+}
+
+static inline bool _is_space (char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+// PBM header: width and height as decimal text, '#' comments to end of line
+static bool _pbm_header (struct mgos_sh1106_image_decoder *d, char c, bool raw)
+{
+  if (d->comment) {
+    d->comment = (c != '\n');
+    return true;
+  }
+  if (c >= '0' && c <= '9') {
+    d->num = d->num * 10 + (c - '0');
+    d->in_num = true;
+    return d->num <= UINT16_MAX;
+  }
+  if (c == '#' && !d->in_num) {
+    d->comment = true;
+    return true;
+  }
+  if (!_is_space (c))
+    return false;
+  if (d->in_num) {
+    if (d->field++ == 0)
+      d->width = d->num;
+    else
+      d->height = d->num;
+    d->num = 0;
+    d->in_num = false;
+    // raw data starts right after the single whitespace ending the height
+    if (d->field == 2)
+      return _begin_pixels (d, raw ? IMAGE_PBM_RAW : IMAGE_PBM_ASCII);
+  }
+  return true;
+}
+
+static inline bool _ends_with (const char *s, uint8_t len, const char *suffix)
+{
+  size_t n = strlen (suffix);
+
+  return len >= n && memcmp (s + len - n, suffix, n) == 0;
+}
+
+// XBM tokens: identifiers and numbers; a number after *_width / *_height
+// sets the size, numbers between the braces are pixel bytes
+static bool _xbm_token (struct mgos_sh1106_image_decoder *d)
+{
+  char *end;
+  unsigned long v;
+
+  if (d->tok_len == 0)
+    return true;
+  d->tok[d->tok_len] = '\0';
+  if (d->tok[0] >= '0' && d->tok[0] <= '9') {
+    v = strtoul (d->tok, &end, 0);
+    if (*end != '\0')
+      return false;
+    if (d->state == IMAGE_XBM_DATA) {
+      _pixels (d, _reverse_bits (v), _byte_pixels (d));
+    } else if (d->field == 1) {
+      d->width = (v <= UINT16_MAX) ? v : 0;
+    } else if (d->field == 2) {
+      d->height = (v <= UINT16_MAX) ? v : 0;
+    }
+    d->field = 0;
+  } else {
+    d->field = _ends_with (d->tok, d->tok_len, "_width") ? 1 : _ends_with (d->tok, d->tok_len, "_height") ? 2 : 0;
+  }
+  d->tok_len = 0;
+  return true;
+}
+
+static bool _xbm_char (struct mgos_sh1106_image_decoder *d, char c)
+{
+  if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') {
+    // long identifiers only matter for their suffix
+    if (d->tok_len == sizeof (d->tok) - 1)
+      memmove (d->tok, d->tok + 1, --d->tok_len);
+    d->tok[d->tok_len++] = c;
+    return true;
+  }
+  if (!_xbm_token (d))
+    return false;
+  if (c == '{' && d->state == IMAGE_XBM_HEADER)
+    return _begin_pixels (d, IMAGE_XBM_DATA);
+  if (c == '}' && d->state == IMAGE_XBM_DATA)
+    return false;               // fewer bytes than width x height
+  return true;
+}
+
+static inline uint32_t _le16 (const uint8_t *p)
+{
+  return p[0] | p[1] << 8;
+}
+
+static inline uint32_t _le32 (const uint8_t *p)
+{
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+// Headers and palette are in; check for an uncompressed 1-bpp image
+static bool _bmp_setup (struct mgos_sh1106_image_decoder *d)
+{
+  uint32_t dib = _le32 (d->hdr + 14);
+  int32_t w, h;
+  uint16_t bpp;
+  uint8_t entry = (dib == 12) ? 3 : 4;
+
+  if (d->hdr[0] != 'B' || d->hdr[1] != 'M' || dib < 12 || _le32 (d->hdr + 10) < 14 + dib + 2 * entry)
+    return false;
+  if (dib == 12) {
+    w = _le16 (d->hdr + 18);
+    h = (int16_t) _le16 (d->hdr + 20);
+    bpp = _le16 (d->hdr + 24);
+  } else {
+    w = _le32 (d->hdr + 18);
+    h = _le32 (d->hdr + 22);
+    bpp = _le16 (d->hdr + 28);
+    if (dib < 40 || _le32 (d->hdr + 30) != 0)   // BI_RGB
+      return false;
+  }
+  if (bpp != 1 || w <= 0 || w > UINT16_MAX || h == 0 || h < -UINT16_MAX || h > UINT16_MAX)
+    return false;
+
+  d->width = w;
+  d->height = (h < 0) ? -h : h;
+  d->bottom_up = h > 0;
+  d->pad = (w + 31) / 32 * 4 - (w + 7) / 8;
+  // ink is the darker palette entry; entries are stored B, G, R
+  const uint8_t *p0 = d->palette, *p1 = d->palette + entry;
+  uint32_t l0 = p0[0] + 5 * p0[1] + 2 * p0[2], l1 = p1[0] + 5 * p1[1] + 2 * p1[2];
+  d->invert = (l0 < l1) ? 0xff : 0x00;
+  return _begin_pixels (d, IMAGE_BMP_DATA);
+}
+
+static bool _bmp_byte (struct mgos_sh1106_image_decoder *d, uint8_t b)
+{
+  uint32_t pos = d->pos++, dib, pal;
+  uint16_t row;
+
+  if (d->state == IMAGE_BMP_DATA) {
+    if (d->pad_left) {
+      --d->pad_left;
+      return true;
+    }
+    row = d->row;
+    _pixels (d, b ^ d->invert, _byte_pixels (d));
+    if (d->row != row)
+      d->pad_left = d->pad;
+    return true;
+  }
+
+  if (pos < BMP_HEADER_SIZE)
+    d->hdr[pos] = b;
+  if (pos >= 18) {
+    dib = _le32 (d->hdr + 14);
+    pal = 14 + dib;
+    if (pos >= pal && pos < pal + sizeof (d->palette))
+      d->palette[pos - pal] = b;
+  }
+  if (pos >= 13 && pos + 1 == _le32 (d->hdr + 10))
+    return _bmp_setup (d);
+  return true;
+}
+
+static bool _feed_byte (struct mgos_sh1106_image_decoder *d, uint8_t b)
+{
+  switch (d->state) {
+  case IMAGE_MAGIC:
+    if (d->pos++ == 0)
+      return b == 'P';
+    if (b != '1' && b != '4')
+      return false;
+    d->raw = (b == '4');
+    d->state = IMAGE_PBM_HEADER;
+    return true;
+  case IMAGE_PBM_HEADER:
+    return _pbm_header (d, b, d->raw);
+  case IMAGE_PBM_ASCII:
+    if (b == '0' || b == '1')
+      _pixels (d, (b == '1') ? 0x80 : 0, 1);
+    else if (!_is_space (b))
+      return false;
+    return true;
+  case IMAGE_PBM_RAW:
+    _pixels (d, b, _byte_pixels (d));
+    return true;
+  case IMAGE_XBM_HEADER:
+  case IMAGE_XBM_DATA:
+    return _xbm_char (d, b);
+  case IMAGE_BMP_HEADER:
+  case IMAGE_BMP_DATA:
+    return _bmp_byte (d, b);
+  case IMAGE_DONE:
+    return true;                // trailing bytes are ignored
+  default:
+    return false;
+  }
+}
+
+struct mgos_sh1106_image_decoder *mgos_sh1106_image_begin (struct mgos_sh1106 *oled, int16_t x, int16_t y,
+                                                          mgos_sh1106_image_format_t format,
+                                                          mgos_sh1106_color_t foreground, mgos_sh1106_color_t background)
+{
+  struct mgos_sh1106_image_decoder *d;
+
+  if (oled == NULL)
+    return NULL;
+
+  d = sh1106_alloc (sizeof (*d));
+  if (d == NULL)
+    return NULL;
+  d->s = oled->target;
+  d->x = x;
+  d->y = y;
+  d->foreground = foreground;
+  d->background = background;
+  d->band_page = INT32_MIN;
+  switch (format) {
+  case SH1106_IMAGE_PBM:
+    d->state = IMAGE_MAGIC;
+    break;
+  case SH1106_IMAGE_XBM:
+    d->state = IMAGE_XBM_HEADER;
+    break;
+  case SH1106_IMAGE_BMP:
+    d->state = IMAGE_BMP_HEADER;
+    break;
+  default:
+    sh1106_release (d);
+    return NULL;
+  }
+  return d;
+}
+
+bool mgos_sh1106_image_feed (struct mgos_sh1106_image_decoder *decoder, const void *data, size_t len)
+{
+  const uint8_t *p = (const uint8_t *) data;
+
+  if (decoder == NULL || (data == NULL && len > 0))
+    return false;
+
+  for (size_t i = 0; i < len && decoder->state != IMAGE_ERROR; ++i) {
+    if (decoder->state == IMAGE_DONE)
+      break;
+    if (!_feed_byte (decoder, p[i])) {
+      LOG (LL_ERROR, ("SH1106 image data invalid at byte %u", (unsigned) i));
+      decoder->state = IMAGE_ERROR;
+    }
+  }
+  return decoder->state != IMAGE_ERROR;
+}
+
+bool mgos_sh1106_image_end (struct mgos_sh1106_image_decoder *decoder)
+{
+  bool done;
+
+  if (decoder == NULL)
+    return false;
+
+  // a partial image keeps the rows already decoded
+  _flush_band (decoder);
+  done = decoder->state == IMAGE_DONE;
+  sh1106_release (decoder->band);
+  sh1106_release (decoder);
+  return done;
+}
+
+bool mgos_sh1106_image_get_size (const struct mgos_sh1106_image_decoder *decoder, uint16_t *width, uint16_t *height)
+{
+  if (decoder == NULL || decoder->width == 0 || decoder->height == 0)
+    return false;
+
+  switch (decoder->state) {
+  case IMAGE_PBM_ASCII:
+  case IMAGE_PBM_RAW:
+  case IMAGE_XBM_DATA:
+  case IMAGE_BMP_DATA:
+  case IMAGE_DONE:
+    break;
+  default:
+    return false;
+  }
+  if (width != NULL)
+    *width = decoder->width;
+  if (height != NULL)
+    *height = decoder->height;
+  return true;
+}
+
+bool mgos_sh1106_draw_image (struct mgos_sh1106 *oled, int16_t x, int16_t y, mgos_sh1106_image_format_t format,
+                             const void *data, size_t len, mgos_sh1106_color_t foreground, mgos_sh1106_color_t background)
+{
+  struct mgos_sh1106_image_decoder *d = mgos_sh1106_image_begin (oled, x, y, format, foreground, background);
+
+  if (d == NULL)
+    return false;
+  mgos_sh1106_image_feed (d, data, len);
+  return mgos_sh1106_image_end (d);
+}
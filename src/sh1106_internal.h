@@ -0,0 +1,248 @@
+/*
+ * Driver state shared by the sh1106 source files; not part of the public API.
+ */
+#ifndef SH1106_INTERNAL_H
+#define SH1106_INTERNAL_H
+
+#include <stdint.h>
+
+#include "mgos_timers.h"
+
+#include "sh1106.h"
+#include "fonts.h"
+
+#ifdef __GNUC__
+#define UNUSED(x) x __attribute__((unused))
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define UNUSED(x) x
+#define ALWAYS_INLINE inline
+#endif
+
+// Call an always-inline drawing body with the target surface's geometry. In
+// fixed geometry builds the canvas case gets compile-time constants, so index
+// math and bounds checks fold into shifts and constant compares.
+#if SH1106_FIXED_GEOMETRY
+#define _WITH_GEOMETRY(oled, fn, ...)                                          \
+  do {                                                                        \
+    if ((oled)->target == &(oled)->canvas)                                    \
+      fn (&(oled)->canvas, SH1106_RAM_WIDTH, SH1106_RAM_HEIGHT, __VA_ARGS__);  \
+    else                                                                      \
+      fn ((oled)->target, (oled)->target->width, (oled)->target->height, __VA_ARGS__); \
+  } while (0)
+#else
+#define _WITH_GEOMETRY(oled, fn, ...) \
+  fn ((oled)->target, (oled)->target->width, (oled)->target->height, __VA_ARGS__)
+#endif
+
+struct mgos_sh1106_surface
+{
+  uint8_t *buffer;              // page format, width bytes per page
+  uint8_t *gray;                // gray plane with the same layout, gray mode only
+  uint16_t width;
+  uint16_t height;              // whole pages
+  uint16_t refresh_top;         // 'Dirty' window corners
+  uint16_t refresh_left;
+  uint16_t refresh_right;
+  uint16_t refresh_bottom;
+#if SH1106_LATENCY_STATS
+  int64_t dirty_since;          // time of the first dirty mark, 0 when clean
+#endif
+};
+
+struct sh1106_priority_region
+{
+  int16_t x;
+  int16_t y;
+  uint16_t width;
+  uint16_t height;
+  uint8_t priority;             // 0 for a free slot
+};
+
+struct mgos_sh1106
+{
+  uint8_t address;              // I2C address
+  uint8_t width;                // panel width
+  uint8_t height;               // panel height
+  struct mgos_sh1106_surface canvas;    // drawing canvas, at least the panel size
+  struct mgos_sh1106_surface *target;   // surface primitives draw into
+  uint16_t view_x;              // canvas position of the panel's top-left pixel
+  uint16_t view_y;
+  uint16_t win_y;               // first canvas row cached in controller RAM
+  uint16_t pending_left;        // canvas columns owed to pending_pages
+  uint16_t pending_right;
+  uint8_t col_offset;           // first RAM column wired to the panel
+  uint8_t row_base;             // RAM row holding canvas row 0
+  uint8_t stale_pages;          // RAM pages out of sync with the canvas
+  uint8_t pending_pages;        // shown RAM pages owed their dirty columns
+  uint8_t gray_phase;           // gray mode subframe last sent
+  mgos_timer_id gray_timer;
+  uint32_t gray_subframes;      // subframes sent since gray_since
+  int64_t gray_since;
+  mgos_sh1106_rotation_t rotation;
+  struct mgos_sh1106_surface *rotated;  // drawing surface while rotated, else NULL
+  struct sh1106_scheduler *scheduler;   // auto refresh state, else NULL
+  struct mgos_sh1106_region *regions;   // list of named regions
+#if SH1106_LATENCY_STATS
+  struct sh1106_latency *latency;       // latency histogram, allocated on the first sample
+#endif
+  struct sh1106_priority_region priority[SH1106_PRIORITY_REGIONS];
+  const font_info_t *font;      // current font
+  struct mgos_i2c *i2c;         // i2c connection
+  bool owns_instance;           // instance and canvas came from the allocator
+  bool owns_canvas;
+};
+
+// Zeroed allocation through the hooks set by mgos_sh1106_set_allocator()
+void *sh1106_alloc (size_t size);
+void sh1106_release (void *ptr);
+
+static inline void _reset_dirty (struct mgos_sh1106_surface *s)
+{
+  s->refresh_top = UINT16_MAX;
+  s->refresh_left = UINT16_MAX;
+  s->refresh_right = 0;
+  s->refresh_bottom = 0;
+#if SH1106_LATENCY_STATS
+  s->dirty_since = 0;
+#endif
+}
+
+// Grow the dirty window; coordinates must already be clipped to the surface
+static inline void _mark_dirty (struct mgos_sh1106_surface *s, uint16_t left, uint16_t top, uint16_t right, uint16_t bottom)
+{
+#if SH1106_LATENCY_STATS
+  if (s->dirty_since == 0)
+    s->dirty_since = mgos_uptime_micros ();
+#endif
+  if (s->refresh_left > left)
+    s->refresh_left = left;
+  if (s->refresh_right < right)
+    s->refresh_right = right;
+  if (s->refresh_top > top)
+    s->refresh_top = top;
+  if (s->refresh_bottom < bottom)
+    s->refresh_bottom = bottom;
+}
+
+// Dirty content moved from src to dst keeps its first dirty mark
+static inline void _carry_dirty_since (struct mgos_sh1106_surface *dst, const struct mgos_sh1106_surface *src)
+{
+#if SH1106_LATENCY_STATS
+  if (src->dirty_since && (dst->dirty_since == 0 || dst->dirty_since > src->dirty_since))
+    dst->dirty_since = src->dirty_since;
+#else
+  (void) dst;
+  (void) src;
+#endif
+}
+
+// Gray levels draw as their nearest mono color on the canvas plane
+static ALWAYS_INLINE mgos_sh1106_color_t _mono (mgos_sh1106_color_t color)
+{
+  if (color == SH1106_COLOR_DARK_GRAY)
+    return SH1106_COLOR_BLACK;
+  if (color == SH1106_COLOR_LIGHT_GRAY)
+    return SH1106_COLOR_WHITE;
+  return color;
+}
+
+// Gray plane bits under mask: set for gray levels, cleared for black and
+// white, kept for invert
+static ALWAYS_INLINE void _gray_bits (struct mgos_sh1106_surface *s, size_t index, uint8_t mask, mgos_sh1106_color_t color)
+{
+  if (s->gray == NULL)
+    return;
+  if (color == SH1106_COLOR_DARK_GRAY || color == SH1106_COLOR_LIGHT_GRAY)
+    s->gray[index] |= mask;
+  else if (color == SH1106_COLOR_WHITE || color == SH1106_COLOR_BLACK)
+    s->gray[index] &= ~mask;
+}
+
+// Paint the bits under mask of one surface byte
+static ALWAYS_INLINE void _paint_bits (struct mgos_sh1106_surface *s, size_t index, uint8_t mask, mgos_sh1106_color_t color)
+{
+  _gray_bits (s, index, mask, color);
+  switch (_mono (color)) {
+  case SH1106_COLOR_WHITE:
+    s->buffer[index] |= mask;
+    break;
+  case SH1106_COLOR_BLACK:
+    s->buffer[index] &= ~mask;
+    break;
+  case SH1106_COLOR_INVERT:
+    s->buffer[index] ^= mask;
+    break;
+  default:
+    break;
+  }
+}
+
+// Bits under mask that a raster operation with source bits v sets or clears;
+// their gray bits no longer apply
+static ALWAYS_INLINE uint8_t _rop_touched (uint8_t v, uint8_t mask, mgos_sh1106_rop_t rop)
+{
+  switch (rop) {
+  case SH1106_ROP_COPY:
+    return mask;
+  case SH1106_ROP_AND:
+    return ~v & mask;
+  default:
+    return v & mask;
+  }
+}
+
+// Combine source bits v into the bits under mask of *d
+static ALWAYS_INLINE void _rop_bits (uint8_t *d, uint8_t v, uint8_t mask, mgos_sh1106_rop_t rop)
+{
+  switch (rop) {
+  case SH1106_ROP_COPY:
+    *d = (*d & ~mask) | (v & mask);
+    break;
+  case SH1106_ROP_OR:
+    *d |= v & mask;
+    break;
+  case SH1106_ROP_AND:
+    *d &= v | ~mask;
+    break;
+  case SH1106_ROP_XOR:
+    *d ^= v & mask;
+    break;
+  case SH1106_ROP_CLEAR:
+    *d &= ~(v & mask);
+    break;
+  }
+}
+
+// Copy the dirty window of the rotated surface onto the canvas under the
+// viewport, or all of it when force is set
+void sh1106_rotate_dirty (struct mgos_sh1106 *oled, bool force);
+
+// Send the dirty windows to the controller now, even in auto refresh mode
+void sh1106_refresh_now (struct mgos_sh1106 *oled, bool force);
+
+// Send only the current dirty windows to the shown RAM pages now; pages
+// owed by an earlier refresh and stale pages stay owed and stale.
+void sh1106_send_dirty (struct mgos_sh1106 *oled);
+
+#if SH1106_LATENCY_STATS
+// Add a draw-to-panel latency sample
+void sh1106_latency_record (struct mgos_sh1106 *oled, int64_t us);
+void sh1106_latency_free (struct mgos_sh1106 *oled);
+#if MGOS_HAVE_RPC_COMMON
+bool sh1106_latency_rpc_init (void);
+#endif
+#endif
+
+// Delete all regions of a display
+void sh1106_regions_free (struct mgos_sh1106 *oled);
+
+// Leave a refresh to the next auto refresh frame; false when auto refresh is off
+bool sh1106_schedule_request (struct mgos_sh1106 *oled, bool force);
+
+// Send len bytes to the first columns of a panel page, bypassing the canvas.
+// The RAM page is marked stale so the next refresh restores the canvas.
+// Fails when the start line is not page aligned.
+bool sh1106_write_panel_page (struct mgos_sh1106 *oled, uint8_t panel_page, const uint8_t *data, uint8_t len);
+
+#endif /* SH1106_INTERNAL_H */
@@ -0,0 +1,149 @@
+/*
+ * Draw-to-panel latency: the first dirty mark on a clean surface takes a
+ * timestamp, which follows the content through rotation and regions onto
+ * the canvas. The refresh that sends the canvas records the elapsed time in
+ * a log-linear histogram: four buckets per power of two, so a percentile is
+ * read back within 25%.
+ */
+#include <string.h>
+
+#include "common/cs_dbg.h"
+
+#include "sh1106.h"
+#include "sh1106_internal.h"
+
+#if SH1106_LATENCY_STATS
+
+#if MGOS_HAVE_RPC_COMMON
+#include "frozen.h"
+#include "mgos_rpc.h"
+#endif
+
+#define LATENCY_MAX_US (1u << 26)
+#define LATENCY_BUCKETS 104
+
+struct sh1106_latency
+{
+  uint32_t count;
+  uint32_t max_us;
+  uint32_t bucket[LATENCY_BUCKETS];
+};
+
+static inline uint8_t _bucket (uint32_t us)
+{
+  uint8_t octave;
+
+  if (us < 4)
+    return us;
+  if (us >= LATENCY_MAX_US)
+    us = LATENCY_MAX_US - 1;
+  octave = 31 - __builtin_clz (us);
+  return (octave - 1) * 4 + ((us >> (octave - 2)) & 3);
+}
+
+// Largest latency that falls in a bucket
+static inline uint32_t _bucket_limit (uint8_t i)
+{
+  uint8_t octave = i / 4 + 1;
+
+  if (i < 4)
+    return i;
+  return ((5u + i % 4) << (octave - 2)) - 1;
+}
+
+void sh1106_latency_record (struct mgos_sh1106 *oled, int64_t us)
+{
+  struct sh1106_latency *l = oled->latency;
+
+  if (l == NULL) {
+    l = oled->latency = sh1106_alloc (sizeof (*l));
+    if (l == NULL)
+      return;
+  }
+  if (us < 0)
+    us = 0;
+  if (us > UINT32_MAX)
+    us = UINT32_MAX;
+  ++l->bucket[_bucket (us)];
+  ++l->count;
+  if (l->max_us < us)
+    l->max_us = us;
+}
+
+void sh1106_latency_free (struct mgos_sh1106 *oled)
+{
+  sh1106_release (oled->latency);
+  oled->latency = NULL;
+}
+
+// Upper bound of the latency under which a permille of the samples fall
+static uint32_t _percentile (const struct sh1106_latency *l, uint32_t permille)
+{
+  uint32_t rank = ((uint64_t) l->count * permille + 999) / 1000, seen = 0;
+
+  for (uint8_t i = 0; i < LATENCY_BUCKETS; ++i) {
+    seen += l->bucket[i];
+    if (seen >= rank)
+      return (_bucket_limit (i) < l->max_us) ? _bucket_limit (i) : l->max_us;
+  }
+  return l->max_us;
+}
+
+bool mgos_sh1106_get_latency (struct mgos_sh1106 *oled, struct mgos_sh1106_latency_stats *stats, bool reset)
+{
+  const struct sh1106_latency *l;
+
+  if (oled == NULL || stats == NULL)
+    return false;
+
+  memset (stats, 0, sizeof (*stats));
+  if ((l = oled->latency) != NULL && l->count) {
+    stats->count = l->count;
+    stats->p50_us = _percentile (l, 500);
+    stats->p95_us = _percentile (l, 950);
+    stats->p99_us = _percentile (l, 990);
+    stats->max_us = l->max_us;
+  }
+  if (reset && oled->latency != NULL)
+    memset (oled->latency, 0, sizeof (*oled->latency));
+  return true;
+}
+
+#if MGOS_HAVE_RPC_COMMON
+static void _rpc_latency (struct mg_rpc_request_info *ri, void *cb_arg, struct mg_rpc_frame_info *fi, struct mg_str args)
+{
+  struct mgos_sh1106_latency_stats st;
+  bool reset = false;
+
+  json_scanf (args.p, args.len, ri->args_fmt, &reset);
+  if (!mgos_sh1106_get_latency (mgos_sh1106_get_global (), &st, reset)) {
+    mg_rpc_send_errorf (ri, 503, "SH1106 is not enabled");
+    return;
+  }
+  mg_rpc_send_responsef (ri, "{count: %u, p50_us: %u, p95_us: %u, p99_us: %u, max_us: %u}", st.count, st.p50_us,
+                         st.p95_us, st.p99_us, st.max_us);
+  (void) cb_arg;
+  (void) fi;
+}
+
+bool sh1106_latency_rpc_init (void)
+{
+  if (mgos_rpc_get_global () == NULL)
+    return false;
+
+  mg_rpc_add_handler (mgos_rpc_get_global (), "SH1106.Latency", "{reset: %B}", _rpc_latency, NULL);
+  return true;
+}
+#endif
+
+#else
+
+bool mgos_sh1106_get_latency (struct mgos_sh1106 *oled, struct mgos_sh1106_latency_stats *stats, bool reset)
+{
+  (void) oled;
+  (void) stats;
+  (void) reset;
+  return false;
+}
+
+#endif
@@ -0,0 +1,168 @@
+/*
+ * Numeric fields: numbers drawn in fixed-width character cells, where an
+ * update redraws, and so dirties, only the cells whose character changed.
+ */
+#include <string.h>
+
+#include "common/cs_dbg.h"
+
+#include "sh1106.h"
+#include "sh1106_internal.h"
+
+#define NUMERIC_MAX_CELLS 16
+
+struct mgos_sh1106_numeric
+{
+  const font_info_t *font;      // font at creation
+  int16_t x;
+  int16_t y;
+  uint8_t cells;
+  uint8_t cell_width;           // widest digit or sign, in pixels
+  uint8_t decimals;
+  mgos_sh1106_numeric_format_t format;
+  mgos_sh1106_color_t foreground;
+  mgos_sh1106_color_t background;
+  char shown[NUMERIC_MAX_CELLS];        // characters on screen, 0 if none yet
+};
+
+struct mgos_sh1106_numeric *mgos_sh1106_numeric_create (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint8_t cells,
+                                                        mgos_sh1106_numeric_format_t format, uint8_t decimals,
+                                                        mgos_sh1106_color_t foreground, mgos_sh1106_color_t background)
+{
+  static const char cell_chars[] = "0123456789-.: ";
+  struct mgos_sh1106_numeric *n;
+  int32_t glyph;
+
+  if (oled == NULL || oled->font == NULL || cells == 0 || cells > NUMERIC_MAX_CELLS)
+    return NULL;
+
+  n = sh1106_alloc (sizeof (*n));
+  if (n == NULL)
+    return NULL;
+  n->font = oled->font;
+  n->x = x;
+  n->y = y;
+  n->cells = cells;
+  n->format = format;
+  n->decimals = (decimals > 9) ? 9 : decimals;
+  n->foreground = foreground;
+  n->background = (background == SH1106_COLOR_TRANSPARENT) ? SH1106_COLOR_BLACK : background;
+  for (const char *c = cell_chars; *c; ++c) {
+    glyph = font_lookup_glyph (n->font, *c);
+    if (glyph >= 0 && font_glyph_width (n->font, glyph) > n->cell_width)
+      n->cell_width = font_glyph_width (n->font, glyph);
+  }
+  return n;
+}
+
+void mgos_sh1106_numeric_free (struct mgos_sh1106_numeric *n)
+{
+  sh1106_release (n);
+}
+
+void mgos_sh1106_numeric_invalidate (struct mgos_sh1106_numeric *n)
+{
+  if (n == NULL)
+    return;
+
+  memset (n->shown, 0, sizeof (n->shown));
+}
+
+uint16_t mgos_sh1106_numeric_get_width (const struct mgos_sh1106_numeric *n)
+{
+  if (n == NULL)
+    return 0;
+
+  return n->cells * (n->cell_width + n->font->c) - n->font->c;
+}
+
+// Digits of v right to left ending at *p, at least min of them
+static char *_digits (char *p, uint32_t v, uint8_t min)
+{
+  const char *end = p;
+
+  do {
+    *--p = '0' + v % 10;
+    v /= 10;
+  } while (v || end - p < min);
+  return p;
+}
+
+// Right-aligned text of value in the field's cells; false if it does not fit
+static bool _format (const struct mgos_sh1106_numeric *n, int32_t value, char *out)
+{
+  char buf[24], *end = buf + sizeof (buf), *p = end;
+  uint32_t v = (value < 0) ? 0u - (uint32_t) value : (uint32_t) value;
+  uint8_t len;
+
+  switch (n->format) {
+  case SH1106_NUMERIC_FIXED:
+    if (n->decimals > 0) {
+      // value is in units of 10^-decimals
+      uint32_t scale = 1;
+      for (uint8_t i = 0; i < n->decimals; ++i)
+        scale *= 10;
+      p = _digits (p, v % scale, n->decimals);
+      *--p = '.';
+      v /= scale;
+    }
+    p = _digits (p, v, 1);
+    break;
+  case SH1106_NUMERIC_TIME:
+    // seconds as [h:]mm:ss, hours shown once there are any
+    p = _digits (p, v % 60, 2);
+    *--p = ':';
+    if (v >= 3600) {
+      p = _digits (p, v / 60 % 60, 2);
+      *--p = ':';
+      p = _digits (p, v / 3600, 1);
+    } else {
+      p = _digits (p, v / 60, 2);
+    }
+    break;
+  default:
+    p = _digits (p, v, 1);
+    break;
+  }
+  if (value < 0)
+    *--p = '-';
+
+  len = end - p;
+  if (len > n->cells)
+    return false;
+  memset (out, ' ', n->cells - len);
+  memcpy (out + n->cells - len, p, len);
+  return true;
+}
+
+bool mgos_sh1106_numeric_set (struct mgos_sh1106 *oled, struct mgos_sh1106_numeric *n, int32_t value)
+{
+  const font_info_t *font;
+  char text[NUMERIC_MAX_CELLS];
+  bool fits;
+  int16_t cx;
+  int32_t glyph;
+
+  if (oled == NULL || n == NULL)
+    return false;
+
+  fits = _format (n, value, text);
+  if (!fits)
+    memset (text, '-', n->cells);
+
+  font = oled->font;
+  oled->font = n->font;
+  for (uint8_t i = 0; i < n->cells; ++i) {
+    if (text[i] == n->shown[i])
+      continue;
+    cx = n->x + i * (n->cell_width + n->font->c);
+    mgos_sh1106_fill_rectangle (oled, cx, n->y, n->cell_width, n->font->height, n->background);
+    glyph = font_lookup_glyph (n->font, text[i]);
+    if (text[i] != ' ' && glyph >= 0)
+      mgos_sh1106_draw_codepoint (oled, cx + (n->cell_width - font_glyph_width (n->font, glyph) + 1) / 2, n->y,
+                                  text[i], n->foreground, SH1106_COLOR_TRANSPARENT);
+    n->shown[i] = text[i];
+  }
+  oled->font = font;
+  return fits;
+}
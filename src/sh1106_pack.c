@@ -0,0 +1,201 @@
+/*
+ * Compressed page-format images.
+ *
+ * Layout: 'P', width (16-bit little endian), height in pages, then the page
+ * bytes (page 0 columns 0..width-1, then page 1, ...) as a sequence of ops:
+ *
+ *   0x00-0x7f  op + 1 literal bytes follow
+ *   0x80-0xbf  (op & 0x3f) + 2 copies of the next byte
+ *   0xc0-0xff  (op & 0x3f) + 3 bytes copied from d + 1 bytes back, d being
+ *              the next byte
+ *
+ * tools/sh1106_pack.py produces these from PBM files or raw page images.
+ */
+#include <string.h>
+
+#include "common/cs_dbg.h"
+
+#include "sh1106.h"
+#include "sh1106_internal.h"
+
+#define PACK_HEADER_SIZE 4
+
+enum sh1106_unpack_op
+{
+  UNPACK_LITERAL,
+  UNPACK_FILL,
+  UNPACK_COPY,
+};
+
+struct sh1106_unpack
+{
+  const uint8_t *src;
+  const uint8_t *end;
+  enum sh1106_unpack_op op;
+  uint8_t count;                // bytes left in the current op
+  uint8_t arg;                  // fill byte or copy distance - 1
+  uint8_t pos;                  // next window slot
+  uint8_t window[256];          // last bytes produced, for copies
+};
+
+static bool _unpack_byte (struct sh1106_unpack *u, uint8_t *out)
+{
+  uint8_t op, b;
+
+  if (u->count == 0) {
+    if (u->src == u->end)
+      return false;
+    op = *u->src++;
+    if (op < 0x80) {
+      u->op = UNPACK_LITERAL;
+      u->count = op + 1;
+    } else {
+      if (u->src == u->end)
+        return false;
+      u->op = (op < 0xc0) ? UNPACK_FILL : UNPACK_COPY;
+      u->count = (op & 0x3f) + ((op < 0xc0) ? 2 : 3);
+      u->arg = *u->src++;
+    }
+  }
+  switch (u->op) {
+  case UNPACK_LITERAL:
+    if (u->src == u->end)
+      return false;
+    b = *u->src++;
+    break;
+  case UNPACK_FILL:
+    b = u->arg;
+    break;
+  default:
+    b = u->window[(uint8_t) (u->pos - u->arg - 1)];
+    break;
+  }
+  u->window[u->pos++] = b;
+  --u->count;
+  *out = b;
+  return true;
+}
+
+static bool _unpack_begin (struct sh1106_unpack *u, const uint8_t *data, size_t len, uint16_t *width, uint8_t *pages)
+{
+  if (data == NULL || len < PACK_HEADER_SIZE || data[0] != 'P')
+    return false;
+
+  *width = data[1] | data[2] << 8;
+  *pages = data[3];
+  u->src = data + PACK_HEADER_SIZE;
+  u->end = data + len;
+  u->count = 0;
+  u->pos = 0;
+  memset (u->window, 0, sizeof (u->window));
+  return *width > 0 && *pages > 0;
+}
+
+bool mgos_sh1106_packed_get_size (const uint8_t *data, size_t len, uint16_t *width, uint16_t *height)
+{
+  if (data == NULL || len < PACK_HEADER_SIZE || data[0] != 'P')
+    return false;
+
+  if (width != NULL)
+    *width = data[1] | data[2] << 8;
+  if (height != NULL)
+    *height = data[3] * 8;
+  return true;
+}
+
+bool mgos_sh1106_draw_packed (struct mgos_sh1106 *oled, int16_t x, int16_t y, const uint8_t *data, size_t len, mgos_sh1106_rop_t rop)
+{
+  struct sh1106_unpack u;
+  struct mgos_sh1106_surface *s;
+  uint16_t width;
+  uint8_t pages, v, top;
+  int32_t row, page, dx;
+  bool ok = true;
+
+  if (oled == NULL || !_unpack_begin (&u, data, len, &width, &pages))
+    return false;
+
+  s = oled->target;
+  top = y & 7;
+  for (uint8_t p = 0; p < pages && ok; ++p) {
+    // source page p covers rows y + 8p .. +7: the bottom of one destination page and the top of the next
+    row = y + p * 8;
+    page = (row - top) / 8;
+    for (uint16_t c = 0; c < width; ++c) {
+      if (!_unpack_byte (&u, &v)) {
+        ok = false;
+        break;
+      }
+      dx = x + c;
+      if (dx < 0 || dx >= s->width)
+        continue;
+      if (page >= 0 && page < s->height / 8) {
+        if (top == 0 && rop == SH1106_ROP_COPY)
+          s->buffer[page * s->width + dx] = v;
+        else
+          _rop_bits (s->buffer + page * s->width + dx, v << top, 0xff << top, rop);
+        if (s->gray != NULL)
+          s->gray[page * s->width + dx] &= ~_rop_touched (v << top, 0xff << top, rop);
+      }
+      if (top && page + 1 >= 0 && page + 1 < s->height / 8) {
+        _rop_bits (s->buffer + (page + 1) * s->width + dx, v >> (8 - top), 0xff >> (8 - top), rop);
+        if (s->gray != NULL)
+          s->gray[(page + 1) * s->width + dx] &= ~_rop_touched (v >> (8 - top), 0xff >> (8 - top), rop);
+      }
+    }
+  }
+
+  // dirty the visible part of the image
+  int32_t left = (x > 0) ? x : 0, right = x + width - 1;
+  int32_t upper = (y > 0) ? y : 0, bottom = y + pages * 8 - 1;
+  if (right >= s->width)
+    right = s->width - 1;
+  if (bottom >= s->height)
+    bottom = s->height - 1;
+  if (left <= right && upper <= bottom)
+    _mark_dirty (s, left, upper, right, bottom);
+  if (!ok)
+    LOG (LL_ERROR, ("SH1106 packed image truncated"));
+  return ok;
+}
+
+bool mgos_sh1106_show_packed (struct mgos_sh1106 *oled, const uint8_t *data, size_t len)
+{
+  struct sh1106_unpack u;
+  struct mgos_sh1106_surface *target;
+  uint8_t line[SH1106_RAM_WIDTH];
+  uint16_t width;
+  uint8_t pages, v;
+  bool ok;
+
+  if (oled == NULL || !_unpack_begin (&u, data, len, &width, &pages))
+    return false;
+
+  for (uint8_t p = 0; p < pages; ++p) {
+    for (uint16_t c = 0; c < width; ++c) {
+      if (!_unpack_byte (&u, &v)) {
+        LOG (LL_ERROR, ("SH1106 packed image truncated"));
+        return false;
+      }
+      if (c < sizeof (line))
+        line[c] = v;
+    }
+    if (p >= (oled->height + 7) / 8)
+      break;
+    if (!sh1106_write_panel_page (oled, p, line, (width < sizeof (line)) ? width : sizeof (line))) {
+      if (p > 0)
+        return false;
+      // panel pages straddle RAM pages after a fine scroll: go through the canvas
+      target = oled->target;
+      oled->target = &oled->canvas;
+      ok = mgos_sh1106_draw_packed (oled, oled->view_x, oled->view_y, data, len, SH1106_ROP_COPY);
+      // on the ring canvas the rows past the bottom wrap to the top
+      if (ok && oled->canvas.height == SH1106_RAM_HEIGHT && oled->view_y + pages * 8 > SH1106_RAM_HEIGHT)
+        ok = mgos_sh1106_draw_packed (oled, oled->view_x, oled->view_y - SH1106_RAM_HEIGHT, data, len, SH1106_ROP_COPY);
+      oled->target = target;
+      mgos_sh1106_refresh (oled, false);
+      return ok;
+    }
+  }
+  return true;
+}
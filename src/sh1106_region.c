@@ -0,0 +1,191 @@
+/*
+ * Named screen regions. Each region draws into a surface of its own, which
+ * clips its drawing and tracks its own dirty window. Servicing the regions
+ * copies a region onto the display surface and sends it on its own schedule,
+ * so one region's changes never force another one onto the bus.
+ */
+#include <string.h>
+
+#include "common/cs_dbg.h"
+
+#include "sh1106.h"
+#include "sh1106_internal.h"
+
+struct mgos_sh1106_region
+{
+  struct mgos_sh1106_region *next;
+  char name[SH1106_REGION_NAME_LEN];
+  int16_t x;                    // display surface position
+  int16_t y;
+  uint16_t width;
+  uint16_t height;
+  uint32_t min_interval_ms;     // least time between two transfers
+  uint32_t max_interval_ms;     // most time between two transfers, 0 for no limit
+  int64_t last_sent;
+  struct mgos_sh1106_surface *surface;
+};
+
+static inline struct mgos_sh1106_surface *_display_surface (struct mgos_sh1106 *oled)
+{
+  return (oled->rotated != NULL) ? oled->rotated : &oled->canvas;
+}
+
+// Add back a dirty window set aside in a copy of the surface
+static void _merge_dirty (struct mgos_sh1106_surface *s, const struct mgos_sh1106_surface *held)
+{
+  if (held->refresh_left > held->refresh_right || held->refresh_top > held->refresh_bottom)
+    return;
+  _mark_dirty (s, held->refresh_left, held->refresh_top, held->refresh_right, held->refresh_bottom);
+  _carry_dirty_since (s, held);
+}
+
+// Blit with the target switched for the duration
+static void _blit_to (struct mgos_sh1106 *oled, struct mgos_sh1106_surface *dst, const struct mgos_sh1106_surface *src,
+                      int16_t sx, int16_t sy, uint16_t w, uint16_t h, int16_t dx, int16_t dy)
+{
+  struct mgos_sh1106_surface *target = oled->target;
+
+  oled->target = dst;
+  mgos_sh1106_blit (oled, src, sx, sy, w, h, dx, dy, SH1106_ROP_COPY);
+  oled->target = target;
+}
+
+struct mgos_sh1106_region *mgos_sh1106_region_create (struct mgos_sh1106 *oled, const char *name, int16_t x, int16_t y,
+                                                      uint16_t w, uint16_t h, uint32_t min_interval_ms,
+                                                      uint32_t max_interval_ms)
+{
+  struct mgos_sh1106_region *r;
+
+  if (oled == NULL || name == NULL || w == 0 || h == 0 || mgos_sh1106_region_find (oled, name) != NULL)
+    return NULL;
+
+  r = sh1106_alloc (sizeof (*r));
+  if (r == NULL || (r->surface = mgos_sh1106_surface_create (w, h)) == NULL) {
+    LOG (LL_ERROR, ("SH1106 region %s allocation failed", name));
+    sh1106_release (r);
+    return NULL;
+  }
+  strncpy (r->name, name, sizeof (r->name) - 1);
+  r->x = x;
+  r->y = y;
+  r->width = w;
+  r->height = h;
+  r->min_interval_ms = min_interval_ms;
+  r->max_interval_ms = max_interval_ms;
+  r->last_sent = mgos_uptime_micros ();
+
+  // start from what the display shows there
+  _blit_to (oled, r->surface, _display_surface (oled), x, y, w, h, 0, 0);
+  _reset_dirty (r->surface);
+
+  r->next = oled->regions;
+  oled->regions = r;
+  return r;
+}
+
+struct mgos_sh1106_region *mgos_sh1106_region_find (struct mgos_sh1106 *oled, const char *name)
+{
+  struct mgos_sh1106_region *r;
+
+  if (oled == NULL || name == NULL)
+    return NULL;
+
+  for (r = oled->regions; r != NULL; r = r->next) {
+    if (strncmp (r->name, name, sizeof (r->name) - 1) == 0)
+      return r;
+  }
+  return NULL;
+}
+
+void mgos_sh1106_region_free (struct mgos_sh1106 *oled, struct mgos_sh1106_region *region)
+{
+  struct mgos_sh1106_region **p;
+
+  if (oled == NULL || region == NULL)
+    return;
+
+  for (p = &oled->regions; *p != NULL; p = &(*p)->next) {
+    if (*p == region) {
+      *p = region->next;
+      break;
+    }
+  }
+  if (oled->target == region->surface)
+    mgos_sh1106_set_target (oled, NULL);
+  mgos_sh1106_surface_free (region->surface);
+  sh1106_release (region);
+}
+
+bool mgos_sh1106_region_select (struct mgos_sh1106 *oled, struct mgos_sh1106_region *region)
+{
+  if (oled == NULL || region == NULL)
+    return false;
+
+  mgos_sh1106_set_target (oled, region->surface);
+  return true;
+}
+
+uint32_t mgos_sh1106_refresh_regions (struct mgos_sh1106 *oled)
+{
+  struct mgos_sh1106_region *r;
+  struct mgos_sh1106_surface *s, *d, held_display, held_canvas;
+  int64_t now, age, wait, next = INT64_MAX;
+  bool dirty;
+
+  if (oled == NULL)
+    return UINT32_MAX;
+
+  now = mgos_uptime_micros ();
+  for (r = oled->regions; r != NULL; r = r->next) {
+    s = r->surface;
+    dirty = s->refresh_left <= s->refresh_right && s->refresh_top <= s->refresh_bottom;
+    age = now - r->last_sent;
+    if (r->max_interval_ms && age >= r->max_interval_ms * 1000LL) {
+      // overdue: resend all of it
+      s->refresh_left = s->refresh_top = 0;
+      s->refresh_right = s->width - 1;
+      s->refresh_bottom = s->height - 1;
+      dirty = true;
+    } else if (!dirty || age < r->min_interval_ms * 1000LL) {
+      wait = INT64_MAX;
+      if (dirty)
+        wait = r->min_interval_ms * 1000LL - age;
+      if (r->max_interval_ms && r->max_interval_ms * 1000LL - age < wait)
+        wait = r->max_interval_ms * 1000LL - age;
+      if (wait < next)
+        next = wait;
+      continue;
+    }
+
+    // only this region's dirty window goes to the display surface and on to
+    // the controller; other drawing stays dirty for the next refresh
+    d = _display_surface (oled);
+    held_display = *d;
+    held_canvas = oled->canvas;
+    _reset_dirty (d);
+    _reset_dirty (&oled->canvas);
+    if (s->refresh_bottom >= r->height)
+      s->refresh_bottom = r->height - 1;
+    if (s->refresh_top <= s->refresh_bottom)
+      _blit_to (oled, d, s, s->refresh_left, s->refresh_top, s->refresh_right - s->refresh_left + 1,
+                s->refresh_bottom - s->refresh_top + 1, r->x + s->refresh_left, r->y + s->refresh_top);
+    _carry_dirty_since (d, s);
+    _reset_dirty (s);
+    sh1106_send_dirty (oled);
+    _merge_dirty (d, &held_display);
+    if (d != &oled->canvas)
+      _merge_dirty (&oled->canvas, &held_canvas);
+    r->last_sent = now;
+    if (r->max_interval_ms && r->max_interval_ms * 1000LL < next)
+      next = r->max_interval_ms * 1000LL;
+  }
+  if (next == INT64_MAX)
+    return UINT32_MAX;
+  return (next + 999) / 1000;
+}
+
+void sh1106_regions_free (struct mgos_sh1106 *oled)
+{
+  while (oled->regions != NULL)
+    mgos_sh1106_region_free (oled, oled->regions);
+}
@@ -0,0 +1,260 @@
+/*
+ * Software rotation for panels mounted portrait or upside down.
+ *
+ * While a rotation is set, drawing goes to a surface in the rotated
+ * orientation. On refresh its dirty window is copied onto the canvas under
+ * the viewport in 8x8 pixel blocks: a block is 8 bytes of one page row in
+ * either orientation, so each one is an 8x8 bit-matrix transpose followed by
+ * a byte or bit order reversal, done on a 64-bit word.
+ */
+#include <string.h>
+
+#include "common/cs_dbg.h"
+
+#include "sh1106.h"
+#include "sh1106_internal.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SH1106_ROTATE_SSE2 1
+#endif
+
+static inline uint64_t _load64 (const uint8_t *p)
+{
+  uint64_t x = 0;
+
+  for (uint8_t i = 0; i < 8; ++i)
+    x |= (uint64_t) p[i] << (8 * i);
+  return x;
+}
+
+static inline void _store64 (uint8_t *p, uint64_t x)
+{
+  for (uint8_t i = 0; i < 8; ++i)
+    p[i] = x >> (8 * i);
+}
+
+// Byte i bit j <-> byte j bit i, three delta swaps
+static inline uint64_t _transpose8 (uint64_t x)
+{
+  uint64_t t;
+
+  t = (x ^ (x >> 7)) & 0x00aa00aa00aa00aaull;
+  x ^= t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000cccc0000ccccull;
+  x ^= t ^ (t << 14);
+  t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0ull;
+  x ^= t ^ (t << 28);
+  return x;
+}
+
+static inline uint64_t _reverse_bytes (uint64_t x)
+{
+#if defined(__GNUC__)
+  return __builtin_bswap64 (x);
+#else
+  x = ((x >> 8) & 0x00ff00ff00ff00ffull) | ((x & 0x00ff00ff00ff00ffull) << 8);
+  x = ((x >> 16) & 0x0000ffff0000ffffull) | ((x & 0x0000ffff0000ffffull) << 16);
+  return (x >> 32) | (x << 32);
+#endif
+}
+
+// Reverse the bits of every byte
+static inline uint64_t _reverse_bits (uint64_t x)
+{
+  x = ((x >> 1) & 0x5555555555555555ull) | ((x & 0x5555555555555555ull) << 1);
+  x = ((x >> 2) & 0x3333333333333333ull) | ((x & 0x3333333333333333ull) << 2);
+  return ((x >> 4) & 0x0f0f0f0f0f0f0f0full) | ((x & 0x0f0f0f0f0f0f0f0full) << 4);
+}
+
+// A transposed block in its final orientation. A block maps column i, row k
+// to: 90 degrees column 7 - k, row i; 270 column k, row 7 - i; 180 column
+// 7 - i, row 7 - k (not transposed).
+static inline uint64_t _orient (uint64_t t, mgos_sh1106_rotation_t rotation)
+{
+  switch (rotation) {
+  case SH1106_ROTATE_90:
+    return _reverse_bytes (t);
+  case SH1106_ROTATE_270:
+    return _reverse_bits (t);
+  default:
+    return _reverse_bits (_reverse_bytes (t));
+  }
+}
+
+#if SH1106_ROTATE_SSE2
+// Transpose the two blocks in 16 bytes: each movemask collects one bit row
+static inline void _transpose8x2 (const uint8_t *src, uint64_t *a, uint64_t *b)
+{
+  __m128i v = _mm_loadu_si128 ((const __m128i *) src);
+  uint32_t m;
+
+  *a = *b = 0;
+  for (int8_t j = 7; j >= 0; --j) {
+    m = _mm_movemask_epi8 (v);
+    *a |= (uint64_t) (m & 0xff) << (8 * j);
+    *b |= (uint64_t) (m >> 8) << (8 * j);
+    v = _mm_add_epi8 (v, v);
+  }
+}
+#endif
+
+// Write the part of one page's 8 columns at x that falls in the surface
+static inline void _store_page (struct mgos_sh1106_surface *s, int32_t x, int32_t page, const uint8_t *bytes,
+                                uint8_t mask)
+{
+  uint8_t *d = s->buffer + page * s->width + x;
+
+  if (page < 0 || page >= s->height / 8)
+    return;
+  _mark_dirty (s, x, page * 8, x + 7, page * 8 + 7);
+  if (mask == 0xff) {
+    memcpy (d, bytes, 8);
+    if (s->gray != NULL)
+      memset (s->gray + page * s->width + x, 0, 8);
+    return;
+  }
+  for (uint8_t i = 0; i < 8; ++i) {
+    _rop_bits (d + i, bytes[i], mask, SH1106_ROP_COPY);
+    if (s->gray != NULL)
+      s->gray[page * s->width + x + i] &= ~mask;
+  }
+}
+
+// Write a block at canvas x, y; y need not be page aligned. On the ring
+// canvas the rows wrap around, anywhere else the block is clipped.
+static void _store_block (struct mgos_sh1106_surface *s, int32_t x, int32_t y, uint64_t block)
+{
+  uint8_t bytes[8], lo[8], hi[8], top;
+  int32_t page, next;
+
+  if (x < 0 || x + 8 > s->width)
+    return;
+  if (s->height == SH1106_RAM_HEIGHT)
+    y &= SH1106_RAM_HEIGHT - 1;
+  top = y & 7;
+  page = y >> 3;
+
+  _store64 (bytes, block);
+  if (top == 0) {
+    _store_page (s, x, page, bytes, 0xff);
+    return;
+  }
+  next = page + 1;
+  if (s->height == SH1106_RAM_HEIGHT)
+    next &= SH1106_RAM_HEIGHT / 8 - 1;
+  for (uint8_t i = 0; i < 8; ++i) {
+    lo[i] = bytes[i] << top;
+    hi[i] = bytes[i] >> (8 - top);
+  }
+  _store_page (s, x, page, lo, 0xff << top);
+  _store_page (s, x, next, hi, 0xff >> (8 - top));
+}
+
+// Canvas block position of logical block bx, by
+static inline void _block_position (const struct mgos_sh1106 *oled, uint16_t bx, uint16_t by, int32_t *x, int32_t *y)
+{
+  uint16_t pw = oled->width / 8, ph = oled->height / 8;
+
+  switch (oled->rotation) {
+  case SH1106_ROTATE_90:
+    *x = pw - 1 - by;
+    *y = bx;
+    break;
+  case SH1106_ROTATE_270:
+    *x = by;
+    *y = ph - 1 - bx;
+    break;
+  default:
+    *x = pw - 1 - bx;
+    *y = ph - 1 - by;
+    break;
+  }
+  *x = oled->view_x + *x * 8;
+  *y = oled->view_y + *y * 8;
+}
+
+void sh1106_rotate_dirty (struct mgos_sh1106 *oled, bool force)
+{
+  struct mgos_sh1106_surface *r = oled->rotated, *c = &oled->canvas;
+  uint16_t bx0, bx1, by0, by1, bx;
+  int32_t x, y;
+  const uint8_t *src;
+  uint64_t t;
+#if SH1106_ROTATE_SSE2
+  uint64_t t2;
+#endif
+
+  if (force) {
+    r->refresh_left = r->refresh_top = 0;
+    r->refresh_right = r->width - 1;
+    r->refresh_bottom = r->height - 1;
+  }
+  if (r->refresh_left > r->refresh_right || r->refresh_top > r->refresh_bottom)
+    return;
+
+  bx0 = r->refresh_left / 8;
+  bx1 = r->refresh_right / 8;
+  by0 = r->refresh_top / 8;
+  by1 = r->refresh_bottom / 8;
+  for (uint16_t by = by0; by <= by1; ++by) {
+    src = r->buffer + by * r->width;
+    for (bx = bx0; bx <= bx1; ++bx) {
+#if SH1106_ROTATE_SSE2
+      if (oled->rotation != SH1106_ROTATE_180 && bx < bx1) {
+        _transpose8x2 (src + bx * 8, &t, &t2);
+        _block_position (oled, bx, by, &x, &y);
+        _store_block (c, x, y, _orient (t, oled->rotation));
+        _block_position (oled, ++bx, by, &x, &y);
+        _store_block (c, x, y, _orient (t2, oled->rotation));
+        continue;
+      }
+#endif
+      t = _load64 (src + bx * 8);
+      if (oled->rotation != SH1106_ROTATE_180)
+        t = _transpose8 (t);
+      _block_position (oled, bx, by, &x, &y);
+      _store_block (c, x, y, _orient (t, oled->rotation));
+    }
+  }
+
+  _carry_dirty_since (c, r);
+  _reset_dirty (r);
+}
+
+bool mgos_sh1106_set_rotation (struct mgos_sh1106 *oled, mgos_sh1106_rotation_t rotation)
+{
+  struct mgos_sh1106_surface *r = NULL;
+
+  if (oled == NULL || rotation > SH1106_ROTATE_270)
+    return false;
+  if (rotation == oled->rotation)
+    return true;
+
+  if (rotation != SH1106_ROTATE_0) {
+    if (rotation == SH1106_ROTATE_180)
+      r = mgos_sh1106_surface_create (oled->width, oled->height);
+    else
+      r = mgos_sh1106_surface_create (oled->height, oled->width);
+    if (r == NULL) {
+      LOG (LL_ERROR, ("SH1106 rotation surface allocation failed"));
+      return false;
+    }
+    // the first refresh covers the whole panel
+    _mark_dirty (r, 0, 0, r->width - 1, r->height - 1);
+  }
+  if (oled->target == &oled->canvas || oled->target == oled->rotated)
+    oled->target = (r != NULL) ? r : &oled->canvas;
+  mgos_sh1106_surface_free (oled->rotated);
+  oled->rotated = r;
+  oled->rotation = rotation;
+  return true;
+}
+
+mgos_sh1106_rotation_t mgos_sh1106_get_rotation (struct mgos_sh1106 *oled)
+{
+  if (oled == NULL)
+    return SH1106_ROTATE_0;
+
+  return oled->rotation;
+}
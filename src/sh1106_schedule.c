@@ -0,0 +1,139 @@
+/*
+ * Auto refresh: a repeating timer flushes the canvas at a target frame rate,
+ * so any number of draws and refresh requests between two frames cost one
+ * set of bus transfers.
+ *
+ * The timer polls for dirty windows rather than being armed by drawing,
+ * which keeps the draw path untouched. A change is first seen up to one tick
+ * after it was made, so for a latency bound the timer ticks at half of it.
+ * Named regions are serviced on every tick, on their own intervals.
+ */
+#include "mgos_timers.h"
+
+#include "common/cs_dbg.h"
+
+#include "sh1106.h"
+#include "sh1106_internal.h"
+
+struct sh1106_scheduler
+{
+  mgos_timer_id timer;
+  int64_t frame_us;             // frame period
+  int64_t latency_us;           // latest flush after a change, 0 for none
+  int64_t tick_us;              // timer period
+  int64_t last_frame;           // time of the last flush
+  int64_t seen;                 // tick that first saw the pending change, 0 if clean
+  bool force;                   // a forced refresh was requested
+  uint32_t frames;              // flushes since stats_since
+  uint32_t requests;            // refresh calls absorbed since stats_since
+  int64_t stats_since;
+};
+
+static inline bool _is_dirty (const struct mgos_sh1106_surface *s)
+{
+  return s->refresh_left <= s->refresh_right && s->refresh_top <= s->refresh_bottom;
+}
+
+static void _tick (void *arg)
+{
+  struct mgos_sh1106 *oled = (struct mgos_sh1106 *) arg;
+  struct sh1106_scheduler *sc = oled->scheduler;
+  int64_t now = mgos_uptime_micros ();
+  bool due;
+
+  if (oled->regions != NULL)
+    mgos_sh1106_refresh_regions (oled);
+  if (!sc->force && !_is_dirty (&oled->canvas) && oled->pending_pages == 0 &&
+      (oled->rotated == NULL || !_is_dirty (oled->rotated))) {
+    sc->seen = 0;
+    return;
+  }
+  if (sc->seen == 0)
+    sc->seen = now;
+
+  // the next frame slot, within half a tick of timer jitter, or the change
+  // would be older than the latency bound by the next tick
+  due = now - sc->last_frame + sc->tick_us / 2 >= sc->frame_us;
+  if (sc->latency_us && now - sc->seen + 2 * sc->tick_us > sc->latency_us)
+    due = true;
+  if (!due)
+    return;
+
+  sh1106_refresh_now (oled, sc->force);
+  sc->force = false;
+  sc->seen = 0;
+  sc->last_frame = now;
+  ++sc->frames;
+}
+
+bool mgos_sh1106_set_auto_refresh (struct mgos_sh1106 *oled, uint16_t fps, uint16_t max_latency_ms)
+{
+  struct sh1106_scheduler *sc;
+  uint32_t tick_ms;
+
+  if (oled == NULL)
+    return false;
+
+  sc = oled->scheduler;
+  if (sc != NULL) {
+    mgos_clear_timer (sc->timer);
+    // flush what the next frame would have
+    sh1106_refresh_now (oled, sc->force);
+    sh1106_release (sc);
+    oled->scheduler = NULL;
+  }
+  if (fps == 0)
+    return true;
+
+  sc = sh1106_alloc (sizeof (*sc));
+  if (sc == NULL) {
+    LOG (LL_ERROR, ("SH1106 scheduler allocation failed"));
+    return false;
+  }
+  tick_ms = (fps < 1000) ? 1000 / fps : 1;
+  if (max_latency_ms && max_latency_ms / 2 < tick_ms)
+    tick_ms = (max_latency_ms > 1) ? max_latency_ms / 2 : 1;
+  sc->frame_us = 1000000 / fps;
+  sc->latency_us = max_latency_ms * 1000LL;
+  sc->tick_us = tick_ms * 1000LL;
+  sc->last_frame = sc->stats_since = mgos_uptime_micros ();
+  oled->scheduler = sc;
+  sc->timer = mgos_set_timer (tick_ms, MGOS_TIMER_REPEAT, _tick, oled);
+  if (sc->timer == MGOS_INVALID_TIMER_ID) {
+    LOG (LL_ERROR, ("SH1106 scheduler timer failed"));
+    sh1106_release (sc);
+    oled->scheduler = NULL;
+    return false;
+  }
+  LOG (LL_INFO, ("SH1106 auto refresh at %u fps, tick %u ms", fps, (unsigned) tick_ms));
+  return true;
+}
+
+bool sh1106_schedule_request (struct mgos_sh1106 *oled, bool force)
+{
+  struct sh1106_scheduler *sc = oled->scheduler;
+
+  if (sc == NULL)
+    return false;
+  sc->force |= force;
+  ++sc->requests;
+  return true;
+}
+
+bool mgos_sh1106_get_auto_refresh_stats (struct mgos_sh1106 *oled, struct mgos_sh1106_refresh_stats *stats)
+{
+  struct sh1106_scheduler *sc;
+  int64_t now;
+
+  if (oled == NULL || stats == NULL || (sc = oled->scheduler) == NULL)
+    return false;
+
+  now = mgos_uptime_micros ();
+  stats->frames = sc->frames;
+  stats->requests = sc->requests;
+  stats->fps = (now > sc->stats_since) ? sc->frames * 1e6f / (now - sc->stats_since) : 0;
+  stats->coalescing = sc->frames ? (float) sc->requests / sc->frames : 0;
+  sc->frames = sc->requests = 0;
+  sc->stats_since = now;
+  return true;
+}
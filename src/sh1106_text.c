@@ -0,0 +1,204 @@
+/*
+ * Text boxes: word wrapping, alignment and ellipsis.
+ *
+ * Layout walks the string once, measuring each character as it is reached,
+ * and records every line as a byte range of the string. Drawing then walks
+ * those ranges, so nothing is copied and nothing is measured twice.
+ */
+#include <string.h>
+
+#include "common/cs_dbg.h"
+
+#include "sh1106.h"
+#include "sh1106_internal.h"
+
+#define TEXT_HALIGN (SH1106_TEXT_CENTER | SH1106_TEXT_RIGHT)
+#define TEXT_VALIGN (SH1106_TEXT_MIDDLE | SH1106_TEXT_BOTTOM)
+#define ELLIPSIS_CP 0x2026
+
+static inline uint8_t _cp_width (const font_info_t *font, uint32_t cp)
+{
+  int32_t glyph = font_lookup_glyph (font, cp);
+
+  return (glyph < 0) ? 0 : font_glyph_width (font, glyph);
+}
+
+// U+2026 when the font has it, else three dots
+static uint16_t _ellipsis_width (const font_info_t *font)
+{
+  int32_t glyph = font_find_glyph (font, ELLIPSIS_CP);
+
+  if (glyph >= 0)
+    return font_glyph_width (font, glyph);
+  return 3 * _cp_width (font, '.') + 2 * font->c;
+}
+
+uint16_t mgos_sh1106_layout_text (struct mgos_sh1106 *oled, uint16_t width, uint16_t height, const char *str,
+                                  uint16_t flags, struct mgos_sh1106_text_layout *layout)
+{
+  const font_info_t *font;
+  const char *p, *s, *q, *end, *next, *brk, *fit;
+  uint16_t max, ell_w = 0, w, nw, brk_w, fit_w, cw;
+  uint32_t cp;
+  bool cut, ellipsis, space;
+
+  if (oled == NULL || oled->font == NULL || str == NULL || layout == NULL)
+    return 0;
+
+  font = oled->font;
+  memset (layout, 0, offsetof (struct mgos_sh1106_text_layout, line));
+  layout->flags = flags;
+  layout->line_height = font->height + font->c;
+  max = SH1106_TEXT_MAX_LINES;
+  if (height && (height + font->c) / layout->line_height < max)
+    max = (height + font->c) / layout->line_height;
+  if (flags & SH1106_TEXT_ELLIPSIS)
+    ell_w = _ellipsis_width (font);
+
+  p = str;
+  while (*p && layout->lines < max) {
+    s = p;
+    w = brk_w = fit_w = 0;
+    brk = NULL;
+    fit = s;
+    cut = space = false;
+    for (;;) {
+      q = p;
+      if (*p == '\0' || *p == '\n') {
+        end = q;
+        next = (*p == '\n') ? p + 1 : p;
+        break;
+      }
+      cp = font_next_char (font, &p, NULL);
+      cw = _cp_width (font, cp);
+      nw = (q == s) ? cw : w + font->c + cw;
+      if (nw > width && q != s) {
+        cut = true;
+        if (!(flags & SH1106_TEXT_WRAP)) {
+          // the rest of this line is clipped
+          end = q;
+          for (next = q; *next && *next != '\n'; ++next);
+          if (*next)
+            ++next;
+          break;
+        }
+        if (cp == ' ' && !space) {
+          brk = q;
+          brk_w = w;
+        }
+        if (brk != NULL) {
+          // break at the last space, dropping the spaces
+          end = brk;
+          w = brk_w;
+          for (next = brk; *next == ' '; ++next);
+        } else {
+          // one word wider than the box: break inside it
+          end = next = q;
+        }
+        break;
+      }
+      // a break drops the whole run of spaces
+      if (cp == ' ' && q != s && !space) {
+        brk = q;
+        brk_w = w;
+      }
+      space = (cp == ' ');
+      w = nw;
+      if (w + font->c + ell_w <= width) {
+        fit = p;
+        fit_w = w;
+      }
+    }
+
+    // ellipsize a clipped line, or the last one when text is left over
+    ellipsis = (flags & SH1106_TEXT_ELLIPSIS) &&
+      ((cut && !(flags & SH1106_TEXT_WRAP)) || (layout->lines + 1 == max && *next != '\0'));
+    if (ellipsis) {
+      if (end != s && w + font->c + ell_w > width) {
+        end = fit;
+        w = fit_w;
+      }
+      w = (end == s) ? ell_w : w + font->c + ell_w;
+    }
+
+    layout->line[layout->lines].start = s - str;
+    layout->line[layout->lines].len = end - s;
+    layout->line[layout->lines].width = w;
+    layout->line[layout->lines].ellipsis = ellipsis;
+    if (layout->width < w)
+      layout->width = w;
+    ++layout->lines;
+    p = next;
+  }
+
+  layout->next = p - str;
+  layout->truncated = (*p != '\0');
+  layout->height = layout->lines ? layout->lines * layout->line_height - font->c : 0;
+  return layout->lines;
+}
+
+uint16_t mgos_sh1106_draw_text_layout (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                       const char *str, const struct mgos_sh1106_text_layout *layout, uint16_t first,
+                                       mgos_sh1106_color_t foreground, mgos_sh1106_color_t background)
+{
+  const struct mgos_sh1106_text_line *line;
+  const char *p, *end;
+  uint16_t count, block, i;
+  int16_t lx, ly;
+
+  if (oled == NULL || oled->font == NULL || str == NULL || layout == NULL || first >= layout->lines)
+    return 0;
+
+  count = layout->lines - first;
+  if (h && (h + oled->font->c) / layout->line_height < count)
+    count = (h + oled->font->c) / layout->line_height;
+  if (count == 0)
+    return 0;
+  block = count * layout->line_height - oled->font->c;
+  if (h > block) {
+    if ((layout->flags & TEXT_VALIGN) == SH1106_TEXT_MIDDLE)
+      y += (h - block) / 2;
+    else if ((layout->flags & TEXT_VALIGN) == SH1106_TEXT_BOTTOM)
+      y += h - block;
+  }
+
+  for (i = 0; i < count; ++i, y += layout->line_height) {
+    line = &layout->line[first + i];
+    lx = x;
+    if (w > line->width) {
+      if ((layout->flags & TEXT_HALIGN) == SH1106_TEXT_CENTER)
+        lx += (w - line->width) / 2;
+      else if ((layout->flags & TEXT_HALIGN) == SH1106_TEXT_RIGHT)
+        lx += w - line->width;
+    }
+    p = str + line->start;
+    end = p + line->len;
+    ly = y;
+    while (p < end) {
+      lx += mgos_sh1106_draw_codepoint (oled, lx, ly, font_next_char (oled->font, &p, end), foreground, background);
+      if (p < end || line->ellipsis)
+        lx += oled->font->c;
+    }
+    if (!line->ellipsis)
+      continue;
+    if (font_find_glyph (oled->font, ELLIPSIS_CP) >= 0) {
+      mgos_sh1106_draw_codepoint (oled, lx, ly, ELLIPSIS_CP, foreground, background);
+    } else {
+      for (uint8_t d = 0; d < 3; ++d)
+        lx += mgos_sh1106_draw_codepoint (oled, lx, ly, '.', foreground, background) + oled->font->c;
+    }
+  }
+  return count;
+}
+
+uint16_t mgos_sh1106_draw_text_box (struct mgos_sh1106 *oled, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                                    const char *str, uint16_t flags, struct mgos_sh1106_text_layout *layout)
+{
+  struct mgos_sh1106_text_layout local;
+
+  if (layout == NULL)
+    layout = &local;
+  if (mgos_sh1106_layout_text (oled, w, h, str, flags, layout) == 0)
+    return 0;
+  return mgos_sh1106_draw_text_layout (oled, x, y, w, h, str, layout, 0, SH1106_COLOR_WHITE, SH1106_COLOR_TRANSPARENT);
+}
@@ -0,0 +1,30 @@
+/* Host stand-in for the Mongoose OS header: warnings and errors go to stderr */
+#pragma once
+#include <stdarg.h>
+#include <stdio.h>
+
+enum cs_log_level
+{
+  LL_NONE = -1,
+  LL_ERROR = 0,
+  LL_WARN = 1,
+  LL_INFO = 2,
+  LL_DEBUG = 3,
+  LL_VERBOSE_DEBUG = 4,
+};
+
+static inline void cs_log_printf (const char *fmt, ...)
+{
+  va_list ap;
+
+  va_start (ap, fmt);
+  vfprintf (stderr, fmt, ap);
+  va_end (ap);
+  fputc ('\n', stderr);
+}
+
+#define LOG(l, x)            \
+  do {                       \
+    if ((l) <= LL_WARN)      \
+      cs_log_printf x;       \
+  } while (0)
@@ -0,0 +1,2 @@
+/* Host stand-in for the Mongoose OS header, for the benchmarks only */
+#pragma once
@@ -0,0 +1,15 @@
+/* Host stand-in for the Mongoose OS header, for the benchmarks only */
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mgos_sys_config.h"
+
+struct mgos_i2c;
+
+struct mgos_i2c *mgos_i2c_create (const struct mgos_config_i2c *cfg);
+struct mgos_i2c *mgos_i2c_get_global (void);
+void mgos_i2c_close (struct mgos_i2c *c);
+bool mgos_i2c_write_reg_b (struct mgos_i2c *c, uint16_t addr, uint8_t reg, uint8_t value);
+bool mgos_i2c_write_reg_n (struct mgos_i2c *c, uint16_t addr, uint8_t reg, size_t n, const uint8_t *buf);
@@ -0,0 +1,3 @@
+/* Host stand-in for the Mongoose OS header, for the benchmarks only */
+#pragma once
+#include <stdbool.h>
@@ -0,0 +1,36 @@
+/* Host stand-in for the generated config, for the benchmarks only */
+#pragma once
+#include <stdbool.h>
+
+struct mgos_config_i2c
+{
+  int enable;
+  int unit_no;
+  int freq;
+  int debug;
+  int scl_gpio;
+  int sda_gpio;
+};
+
+struct mgos_config_sh1106_i2c
+{
+  int enable;
+  int freq;
+  int unit_no;
+  int debug;
+  int sda_gpio;
+  int scl_gpio;
+};
+
+struct mgos_config_sh1106
+{
+  int enable;
+  int width;
+  int height;
+  int address;
+  int col_offset;
+  struct mgos_config_sh1106_i2c i2c;
+};
+
+bool mgos_sys_config_get_sh1106_enable (void);
+const struct mgos_config_sh1106 *mgos_sys_config_get_sh1106 (void);
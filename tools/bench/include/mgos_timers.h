@@ -0,0 +1,13 @@
+/* Host stand-in for the Mongoose OS header, for the benchmarks only */
+#pragma once
+#include <stdint.h>
+
+typedef uintptr_t mgos_timer_id;
+typedef void (*timer_callback) (void *param);
+
+#define MGOS_INVALID_TIMER_ID ((mgos_timer_id) 0)
+#define MGOS_TIMER_REPEAT 1
+
+mgos_timer_id mgos_set_timer (int msecs, int flags, timer_callback cb, void *cb_arg);
+void mgos_clear_timer (mgos_timer_id id);
+int64_t mgos_uptime_micros (void);
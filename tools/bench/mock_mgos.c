@@ -0,0 +1,94 @@
+/*
+ * Mongoose OS stand-ins for the host benchmarks: an I2C bus that only
+ * counts what would go over the wire, a panel config, a monotonic clock
+ * and timers that never fire.
+ */
+#include <time.h>
+
+#include "mgos_i2c.h"
+#include "mgos_sys_config.h"
+#include "mgos_timers.h"
+
+#include "mock_mgos.h"
+
+struct mock_bus mock_bus;
+
+static const struct mgos_config_sh1106 s_config = {
+  .enable = 1,
+  .width = 128,
+  .height = 64,
+  .address = 0x3c,
+  .col_offset = -1,
+  .i2c = {.enable = 0,.freq = 400000,.sda_gpio = -1,.scl_gpio = -1},
+};
+
+bool mgos_sys_config_get_sh1106_enable (void)
+{
+  return true;
+}
+
+const struct mgos_config_sh1106 *mgos_sys_config_get_sh1106 (void)
+{
+  return &s_config;
+}
+
+struct mgos_i2c *mgos_i2c_create (const struct mgos_config_i2c *cfg)
+{
+  (void) cfg;
+  return (struct mgos_i2c *) &mock_bus;
+}
+
+struct mgos_i2c *mgos_i2c_get_global (void)
+{
+  return (struct mgos_i2c *) &mock_bus;
+}
+
+void mgos_i2c_close (struct mgos_i2c *c)
+{
+  (void) c;
+}
+
+// A write is the address byte, the control byte and the payload
+bool mgos_i2c_write_reg_n (struct mgos_i2c *c, uint16_t addr, uint8_t reg, size_t n, const uint8_t *buf)
+{
+  (void) c;
+  (void) addr;
+  (void) buf;
+  ++mock_bus.transactions;
+  mock_bus.bytes += n + 2;
+  if (reg == 0x40)
+    mock_bus.data_bytes += n;
+  return true;
+}
+
+bool mgos_i2c_write_reg_b (struct mgos_i2c *c, uint16_t addr, uint8_t reg, uint8_t value)
+{
+  return mgos_i2c_write_reg_n (c, addr, reg, 1, &value);
+}
+
+mgos_timer_id mgos_set_timer (int msecs, int flags, timer_callback cb, void *cb_arg)
+{
+  (void) msecs;
+  (void) flags;
+  (void) cb;
+  (void) cb_arg;
+  return 1;
+}
+
+void mgos_clear_timer (mgos_timer_id id)
+{
+  (void) id;
+}
+
+int64_t mgos_uptime_micros (void)
+{
+  return mock_now_ns () / 1000;
+}
+
+int64_t mock_now_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <stdint.h>
+
+// Traffic on the mock I2C bus
+struct mock_bus
+{
+  uint64_t transactions;
+  uint64_t bytes;               // everything on the wire, addresses included
+  uint64_t data_bytes;          // display data only
+};
+
+extern struct mock_bus mock_bus;
+
+int64_t mock_now_ns (void);
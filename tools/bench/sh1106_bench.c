@@ -0,0 +1,436 @@
+/*
+ * Host microbenchmarks for the drawing primitives and the refresh path,
+ * against a mock I2C bus that counts bytes instead of sending them.
+ *
+ *   sh1106_bench [--json] [--time MS] [--repeat N] [--filter TEXT]
+ *                [--compare BASELINE] [--tolerance PCT]
+ *
+ * Every case calls one public function with a fixed, seeded set of
+ * parameters drawn the way applications use it: mostly on screen, some
+ * clipped, short spans more often than long ones. The set is run in passes
+ * for --time ms, split over --repeat runs from a fresh screen; it reports
+ * the time per call in the fastest pass and the bytes the call put on the
+ * bus.
+ *
+ * --json prints one object per line; saved to a file it is a baseline for
+ * --compare, which exits 1 when a case is slower than the baseline by more
+ * than --tolerance percent or sends more bytes.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sh1106.h"
+
+#include "mock_mgos.h"
+
+#define OPS 1024                // calls per pass, parameters made up front
+#define MAX_CASES 64
+
+struct params
+{
+  int16_t x;
+  int16_t y;
+  uint16_t w;
+  uint16_t h;
+  mgos_sh1106_color_t color;
+  uint8_t index;                // character or label
+};
+
+struct bench
+{
+  const char *name;
+  void (*gen) (struct params *p);
+  void (*fn) (const struct params *p);
+  int8_t font;                  // font to select, -1 for none
+};
+
+struct result
+{
+  char name[64];
+  double ns_per_op;
+  double bytes_per_op;
+  uint64_t ops;                 // calls measured over all runs
+};
+
+static struct mgos_sh1106 *s_oled;
+static struct params s_params[OPS];
+static uint32_t s_seed;
+
+static char *s_labels[] = {
+  "12:34", "23.5 C", "Battery 87%", "Hello, world!", "WiFi: MyNetwork", "Set point 120", "OK", "-40.25",
+};
+
+#define LABELS (sizeof (s_labels) / sizeof (s_labels[0]))
+
+static uint32_t _rand (void)
+{
+  s_seed ^= s_seed << 13;
+  s_seed ^= s_seed >> 17;
+  s_seed ^= s_seed << 5;
+  return s_seed;
+}
+
+// lo..hi inclusive
+static int32_t _range (int32_t lo, int32_t hi)
+{
+  return lo + (int32_t) (_rand () % (uint32_t) (hi - lo + 1));
+}
+
+static mgos_sh1106_color_t _color (void)
+{
+  static const mgos_sh1106_color_t colors[] = { SH1106_COLOR_WHITE, SH1106_COLOR_BLACK, SH1106_COLOR_INVERT };
+
+  return colors[_rand () % 3];
+}
+
+// Spans: three in four are short, the rest up to the panel width
+static uint16_t _length (uint16_t max)
+{
+  return (_rand () % 4) ? _range (1, 24) : _range (1, max);
+}
+
+static void _gen_point (struct params *p)
+{
+  p->x = _range (-4, 131);
+  p->y = _range (-4, 67);
+  p->color = _color ();
+}
+
+static void _gen_span (struct params *p)
+{
+  p->x = _range (-16, 127);
+  p->y = _range (-4, 67);
+  p->w = _length (128);
+  p->h = _length (64);
+  p->color = _color ();
+}
+
+static void _gen_rect (struct params *p)
+{
+  p->x = _range (-8, 127);
+  p->y = _range (-8, 63);
+  p->w = _range (1, 48);
+  p->h = _range (1, 48);
+  p->color = _color ();
+}
+
+static void _gen_circle (struct params *p)
+{
+  p->x = _range (0, 127);
+  p->y = _range (0, 63);
+  p->w = _range (1, 24);
+  p->color = _color ();
+}
+
+static void _gen_char (struct params *p)
+{
+  p->x = _range (-4, 123);
+  p->y = _range (-4, 59);
+  p->index = _range (' ', '~');
+  p->color = (_rand () % 2) ? SH1106_COLOR_WHITE : SH1106_COLOR_INVERT;
+}
+
+static void _gen_label (struct params *p)
+{
+  p->x = _range (0, 100);
+  p->y = _range (0, 56);
+  p->index = _rand () % LABELS;
+}
+
+static void _gen_none (struct params *p)
+{
+  (void) p;
+}
+
+static void _pixel (const struct params *p)
+{
+  mgos_sh1106_draw_pixel (s_oled, p->x, p->y, p->color);
+}
+
+static void _hline (const struct params *p)
+{
+  mgos_sh1106_draw_hline (s_oled, p->x, p->y, p->w, p->color);
+}
+
+static void _vline (const struct params *p)
+{
+  mgos_sh1106_draw_vline (s_oled, p->x, p->y, p->h, p->color);
+}
+
+static void _rectangle (const struct params *p)
+{
+  mgos_sh1106_draw_rectangle (s_oled, p->x, p->y, p->w, p->h, p->color);
+}
+
+static void _fill_rectangle (const struct params *p)
+{
+  mgos_sh1106_fill_rectangle (s_oled, p->x, p->y, p->w, p->h, p->color);
+}
+
+static void _circle (const struct params *p)
+{
+  mgos_sh1106_draw_circle (s_oled, p->x, p->y, p->w, p->color);
+}
+
+static void _fill_circle (const struct params *p)
+{
+  mgos_sh1106_fill_circle (s_oled, p->x, p->y, p->w, p->color);
+}
+
+static void _draw_char (const struct params *p)
+{
+  mgos_sh1106_draw_char (s_oled, p->x, p->y, p->index, p->color, SH1106_COLOR_TRANSPARENT);
+}
+
+static void _draw_string (const struct params *p)
+{
+  mgos_sh1106_draw_string (s_oled, p->x, p->y, s_labels[p->index]);
+}
+
+static void _measure_string (const struct params *p)
+{
+  mgos_sh1106_measure_string (s_oled, s_labels[p->index]);
+}
+
+static void _clear (const struct params *p)
+{
+  (void) p;
+  mgos_sh1106_clear (s_oled);
+}
+
+// A small change, then the refresh that sends it
+static void _refresh_small (const struct params *p)
+{
+  mgos_sh1106_fill_rectangle (s_oled, p->x, p->y, 8, 8, SH1106_COLOR_INVERT);
+  mgos_sh1106_refresh (s_oled, false);
+}
+
+static void _refresh_clean (const struct params *p)
+{
+  (void) p;
+  mgos_sh1106_refresh (s_oled, false);
+}
+
+static void _refresh_full (const struct params *p)
+{
+  (void) p;
+  mgos_sh1106_refresh (s_oled, true);
+}
+
+// Rotated drawing under a viewport at any row, so the blocks land
+// unaligned and wrap around the ring canvas
+static void _refresh_rotated (const struct params *p)
+{
+  mgos_sh1106_set_rotation (s_oled, SH1106_ROTATE_90);
+  mgos_sh1106_set_viewport (s_oled, 0, p->h * 7);
+  mgos_sh1106_fill_rectangle (s_oled, p->y, p->x, 8, 8, SH1106_COLOR_INVERT);
+  mgos_sh1106_refresh (s_oled, false);
+}
+
+static const struct bench s_benches[] = {
+  {"pixel", _gen_point, _pixel, -1},
+  {"hline", _gen_span, _hline, -1},
+  {"vline", _gen_span, _vline, -1},
+  {"rectangle", _gen_rect, _rectangle, -1},
+  {"fill_rectangle", _gen_rect, _fill_rectangle, -1},
+  {"circle", _gen_circle, _circle, -1},
+  {"fill_circle", _gen_circle, _fill_circle, -1},
+  {"draw_char/glcd_5x7", _gen_char, _draw_char, FONT_GLCD_5X7},
+  {"draw_char/tahoma_8pt", _gen_char, _draw_char, FONT_TAHOMA_8PT},
+  {"draw_string/glcd_5x7", _gen_label, _draw_string, FONT_GLCD_5X7},
+  {"draw_string/tahoma_8pt", _gen_label, _draw_string, FONT_TAHOMA_8PT},
+  {"measure_string/glcd_5x7", _gen_label, _measure_string, FONT_GLCD_5X7},
+  {"measure_string/tahoma_8pt", _gen_label, _measure_string, FONT_TAHOMA_8PT},
+  {"clear", _gen_none, _clear, -1},
+  {"refresh/small", _gen_rect, _refresh_small, -1},
+  {"refresh/clean", _gen_none, _refresh_clean, -1},
+  {"refresh/full", _gen_none, _refresh_full, -1},
+  {"refresh/rotated", _gen_rect, _refresh_rotated, -1},
+};
+
+#define BENCHES (sizeof (s_benches) / sizeof (s_benches[0]))
+
+static void _run (const struct bench *b, double min_ns, int repeat, struct result *r)
+{
+  uint64_t ops = 0, total = 0, bytes;
+  int64_t start, pass, best = -1, end;
+
+  s_seed = 0x5eed1106;
+  for (int i = 0; i < OPS; ++i)
+    b->gen (&s_params[i]);
+  if (b->font >= 0)
+    mgos_sh1106_select_font (s_oled, b->font);
+
+  snprintf (r->name, sizeof (r->name), "%s", b->name);
+  for (int k = 0; k < repeat; ++k) {
+    // same starting state for every run, warmed up by one pass
+    mgos_sh1106_clear (s_oled);
+    mgos_sh1106_refresh (s_oled, true);
+    for (int i = 0; i < OPS; ++i)
+      b->fn (&s_params[i]);
+
+    // the fastest pass is the one least disturbed by the rest of the system
+    bytes = mock_bus.bytes;
+    end = mock_now_ns () + min_ns;
+    do {
+      start = mock_now_ns ();
+      for (int i = 0; i < OPS; ++i)
+        b->fn (&s_params[i]);
+      pass = mock_now_ns () - start;
+      if (best < 0 || pass < best)
+        best = pass;
+      ops += OPS;
+    } while (start + pass < end);
+    r->bytes_per_op = (double) (mock_bus.bytes - bytes) / ops;
+    total += ops;
+    ops = 0;
+  }
+  mgos_sh1106_set_rotation (s_oled, SH1106_ROTATE_0);
+  mgos_sh1106_set_viewport (s_oled, 0, 0);
+  r->ns_per_op = (double) best / OPS;
+  r->ops = total;
+}
+
+static int _load_baseline (const char *path, struct result *base, int max)
+{
+  char line[256];
+  int n = 0;
+  FILE *f = fopen (path, "r");
+
+  if (f == NULL) {
+    perror (path);
+    return -1;
+  }
+  while (n < max && fgets (line, sizeof (line), f) != NULL) {
+    if (sscanf (line, " {\"name\": \"%63[^\"]\", \"ns_per_op\": %lf, \"bytes_per_op\": %lf", base[n].name,
+                &base[n].ns_per_op, &base[n].bytes_per_op) == 3)
+      ++n;
+  }
+  fclose (f);
+  return n;
+}
+
+// Compare against a baseline; the number of regressions plus the baseline
+// cases that were not run and not excluded by filter
+static int _compare (const struct result *res, int n, const struct result *base, int nbase, const char *filter,
+                     double tolerance)
+{
+  const struct result *b;
+  const char *verdict;
+  double change;
+  int regressions = 0, i;
+
+  fprintf (stderr, "%-28s %12s %12s %8s %10s %10s\n", "case", "base ns/op", "ns/op", "change", "base B/op", "B/op");
+  for (i = 0; i < n; ++i) {
+    b = NULL;
+    for (int j = 0; j < nbase && b == NULL; ++j) {
+      if (strcmp (res[i].name, base[j].name) == 0)
+        b = &base[j];
+    }
+    if (b == NULL) {
+      fprintf (stderr, "%-28s %12s %12.1f %8s %10s %10.1f  new\n", res[i].name, "-", res[i].ns_per_op, "-", "-",
+               res[i].bytes_per_op);
+      continue;
+    }
+    change = (b->ns_per_op > 0) ? 100.0 * (res[i].ns_per_op - b->ns_per_op) / b->ns_per_op : 0;
+    verdict = "";
+    if (change > tolerance || res[i].bytes_per_op > b->bytes_per_op + 0.01) {
+      verdict = "  REGRESSION";
+      ++regressions;
+    }
+    fprintf (stderr, "%-28s %12.1f %12.1f %+7.1f%% %10.1f %10.1f%s\n", res[i].name, b->ns_per_op, res[i].ns_per_op,
+             change, b->bytes_per_op, res[i].bytes_per_op, verdict);
+  }
+  for (int j = 0; j < nbase; ++j) {
+    if (filter != NULL && strstr (base[j].name, filter) == NULL)
+      continue;
+    for (i = 0; i < n && strcmp (res[i].name, base[j].name) != 0; ++i)
+      ;
+    if (i == n) {
+      fprintf (stderr, "%-28s %12.1f %12s %8s %10.1f %10s  NOT RUN\n", base[j].name, base[j].ns_per_op, "-", "-",
+               base[j].bytes_per_op, "-");
+      ++regressions;
+    }
+  }
+  return regressions;
+}
+
+static void _usage (const char *prog)
+{
+  fprintf (stderr, "usage: %s [--json] [--time MS] [--repeat N] [--filter TEXT] [--compare BASELINE] [--tolerance PCT]\n",
+           prog);
+  exit (2);
+}
+
+int main (int argc, char **argv)
+{
+  static struct result res[MAX_CASES], base[MAX_CASES];
+  const char *filter = NULL, *baseline = NULL;
+  double time_ms = 250, tolerance = 10;
+  int repeat = 5, n = 0, nbase = 0, regressions;
+  bool json = false;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp (argv[i], "--json") == 0)
+      json = true;
+    else if (strcmp (argv[i], "--time") == 0 && i + 1 < argc)
+      time_ms = atof (argv[++i]);
+    else if (strcmp (argv[i], "--repeat") == 0 && i + 1 < argc)
+      repeat = atoi (argv[++i]);
+    else if (strcmp (argv[i], "--filter") == 0 && i + 1 < argc)
+      filter = argv[++i];
+    else if (strcmp (argv[i], "--compare") == 0 && i + 1 < argc)
+      baseline = argv[++i];
+    else if (strcmp (argv[i], "--tolerance") == 0 && i + 1 < argc)
+      tolerance = atof (argv[++i]);
+    else
+      _usage (argv[0]);
+  }
+  if (repeat < 1 || time_ms <= 0)
+    _usage (argv[0]);
+  if (baseline != NULL && (nbase = _load_baseline (baseline, base, MAX_CASES)) < 0)
+    return 2;
+  if (baseline != NULL && nbase == 0) {
+    fprintf (stderr, "FAIL: no cases in %s, expected the --json output\n", baseline);
+    return 2;
+  }
+
+  s_oled = mgos_sh1106_create (mgos_sys_config_get_sh1106 ());
+  if (s_oled == NULL) {
+    fprintf (stderr, "driver creation failed\n");
+    return 2;
+  }
+
+  if (json)
+    printf ("[\n");
+  else
+    printf ("%-28s %12s %12s %14s\n", "case", "ns/op", "bytes/op", "ops");
+  for (size_t i = 0; i < BENCHES; ++i) {
+    if (filter != NULL && strstr (s_benches[i].name, filter) == NULL)
+      continue;
+    _run (&s_benches[i], time_ms * 1e6 / repeat, repeat, &res[n]);
+    if (json)
+      printf ("%s  {\"name\": \"%s\", \"ns_per_op\": %.2f, \"bytes_per_op\": %.2f, \"ops\": %llu}", n ? ",\n" : "",
+              res[n].name, res[n].ns_per_op, res[n].bytes_per_op, (unsigned long long) res[n].ops);
+    else
+      printf ("%-28s %12.1f %12.1f %14llu\n", res[n].name, res[n].ns_per_op, res[n].bytes_per_op,
+              (unsigned long long) res[n].ops);
+    fflush (stdout);
+    ++n;
+  }
+  if (json)
+    printf ("\n]\n");
+  mgos_sh1106_close (s_oled);
+
+  if (baseline == NULL)
+    return 0;
+  regressions = _compare (res, n, base, nbase, filter, tolerance);
+  if (regressions) {
+    fprintf (stderr, "FAIL: %d cases regressed or were not run against %s (tolerance %.0f%%)\n", regressions,
+             baseline, tolerance);
+    return 1;
+  }
+  fprintf (stderr, "OK: no regressions against %s\n", baseline);
+  return 0;
+}
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Build an sh1106 asset pack of fonts and images.
+
+The pack is used in place through a memory mapping, see
+src/sh1106_assets.c for the layout. Flash it to a data partition and open
+it with mgos_sh1106_assets_open_partition(), or open the file with
+mgos_sh1106_assets_open_file() on hosts.
+
+    tools/sh1106_assets.py -o assets.bin \\
+        --font small=src/font_glcd_5x7.c --font text=src/font_tahoma_8pt.c:rle \\
+        --image splash=splash.pbm --bitmap icon=icon.pbm
+"""
+import argparse
+import struct
+import sys
+
+import sh1106_font
+import sh1106_pack
+
+VERSION = 1
+HEADER = 16
+ENTRY = 32
+FONT, PACKED, BITMAP = 1, 2, 3
+ENCODINGS = {"raw": 0, "packed": 1, "rle": 2}
+
+
+def fnv1a(data):
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xffffffff
+    return h
+
+
+def align(data):
+    return data + bytes(-len(data) % 4)
+
+
+def font_entry(path, encoding):
+    """Return (a, b, c, p, q, data) of a font source file."""
+    with open(path) as f:
+        _, (height, spacing, start, end), descs, bitmap = sh1106_font.parse_font(f.read())
+    glyphs = {"raw": [(bytes(bitmap[off:off + (w + 7) // 8 * height]), 0) for w, off in descs]}
+    for enc, fn in (("packed", sh1106_font.encode_packed), ("rle", sh1106_font.encode_rle)):
+        glyphs[enc] = [fn(sh1106_font.glyph_bits(bitmap, off, w, height)) for w, off in descs]
+    if encoding is None:
+        encoding = min(glyphs, key=lambda e: sum(len(g) for g, _ in glyphs[e]))
+    table, data = bytearray(), bytearray()
+    for (w, _), (g, _) in zip(descs, glyphs[encoding]):
+        table += struct.pack("<BxH", w, len(data))
+        data += g
+    if len(data) > 0xffff:
+        sys.exit("%s: encoded bitmap exceeds 16-bit offsets" % path)
+    sys.stderr.write("%s: %s, %d glyphs, %d bytes\n" % (path, encoding, len(descs), len(table) + len(data)))
+    return ENCODINGS[encoding], height, spacing, start, end, align(bytes(table)) + bytes(data)
+
+
+def image_entry(path, packed):
+    with open(path, "rb") as f:
+        width, height, rows = sh1106_pack.read_pbm(f.read())
+    raw = bytes(sh1106_pack.to_pages(width, height, rows))
+    pages = (height + 7) // 8
+    if packed:
+        data = bytes((ord("P"), width & 0xff, width >> 8, pages)) + sh1106_pack.pack(raw)
+    else:
+        data = raw
+    sys.stderr.write("%s: %dx%d, %d bytes\n" % (path, width, pages * 8, len(data)))
+    return 0, 0, 0, width, pages * 8, data
+
+
+def named(arg):
+    name, _, path = arg.partition("=")
+    if not path or not 0 < len(name.encode()) < 16:
+        raise argparse.ArgumentTypeError("expected NAME=PATH, NAME up to 15 bytes")
+    return name, path
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("-o", "--output", required=True)
+    ap.add_argument("--font", type=named, action="append", default=[],
+                    help="NAME=FONT.c[:raw|packed|rle], smallest encoding by default")
+    ap.add_argument("--image", type=named, action="append", default=[], help="NAME=IMAGE.pbm, stored packed")
+    ap.add_argument("--bitmap", type=named, action="append", default=[], help="NAME=IMAGE.pbm, stored raw")
+    args = ap.parse_args()
+
+    entries = []
+    for name, spec in args.font:
+        path, _, enc = spec.partition(":")
+        if enc and enc not in ENCODINGS:
+            sys.exit("unknown font encoding %s" % enc)
+        entries.append((name, FONT) + font_entry(path, enc or None))
+    for name, path in args.image:
+        entries.append((name, PACKED) + image_entry(path, True))
+    for name, path in args.bitmap:
+        entries.append((name, BITMAP) + image_entry(path, False))
+
+    offset = HEADER + ENTRY * len(entries)
+    table, blobs = bytearray(), bytearray()
+    for name, kind, a, b, c, p, q, data in entries:
+        table += struct.pack("<16sBBBBHHII", name.encode(), kind, a, b, c, p, q, offset + len(blobs), len(data))
+        blobs += align(data)
+    size = offset + len(blobs)
+    pack = b"SHAP" + struct.pack("<HHII", VERSION, len(entries), size, fnv1a(table)) + table + blobs
+    with open(args.output, "wb") as f:
+        f.write(pack)
+    sys.stderr.write("%s: %d entries, %d bytes\n" % (args.output, len(entries), size))
+
+
+if __name__ == "__main__":
+    main()
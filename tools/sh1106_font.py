@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""Compress a font source file (src/font_*.c layout) for the sh1106 driver.
+
+Glyph bitmaps are re-encoded as FONT_ENCODING_PACKED (pixels as one bit
+string, no row padding) or FONT_ENCODING_RLE (alternating off/on run
+lengths in nibbles); glyph widths are kept and offsets recomputed. Fonts
+with a descriptor array or with dense widths/offsets tables are read; the
+dense tables are written. The report on stderr gives the size and
+compression ratio of each encoding and the decode cost per glyph: pixels
+visited for packed glyphs, runs read for RLE glyphs, and the
+SH1106_GLYPH_CACHE_BYTES the compressed font needs: font_register() rejects
+fonts whose largest decoded glyph exceeds it. Without --encoding the
+smaller one is written.
+
+    tools/sh1106_font.py src/font_glcd_5x7.c -o src/font_glcd_5x7_rle.c
+"""
+import argparse
+import re
+import sys
+
+
+def parse_font(text):
+    """Return (name, info fields, descriptors, bitmap bytes) of a font source."""
+    body = re.sub(r"//[^\n]*|/\*.*?\*/", "", text, flags=re.S)
+    bitmap = [int(v, 16) for v in re.search(r"_bitmaps\[\]\s*=\s*\{(.*?)\}", body, re.S).group(1).split(",")
+              if v.strip()]
+    table = re.search(r"_descriptors\[\]\s*=\s*\{(.*?)\};", body, re.S)
+    if table:
+        descs = [(int(w), int(o)) for w, o in re.findall(r"\{\s*(\d+)\s*,\s*(\d+)\s*\}", table.group(1))]
+    else:
+        # dense tables: _widths[] and _offsets[]
+        widths, offsets = ([int(v) for v in re.search(r"_%s\[\]\s*=\s*\{(.*?)\};" % t, body, re.S).group(1).split(",")
+                            if v.strip()] for t in ("widths", "offsets"))
+        descs = list(zip(widths, offsets))
+    m = re.search(r"font_info_t\s+(\w+)_font_info\s*=\s*\{(.*?)\};", body, re.S)
+    fields = [f.strip() for f in m.group(2).split(",") if f.strip()]
+
+    def value(f):
+        if f.startswith("'"):
+            return ord(f[1:-1].encode().decode("unicode_escape"))
+        return int(f, 0)
+    height, spacing, start, end = (value(f) for f in fields[:4])
+    return m.group(1), (height, spacing, start, end), descs, bitmap
+
+
+def glyph_bits(bitmap, offset, width, height):
+    stride = (width + 7) // 8
+    return [(bitmap[offset + y * stride + x // 8] >> (7 - x % 8)) & 1
+            for y in range(height) for x in range(width)]
+
+
+def encode_packed(bits):
+    out = bytearray((len(bits) + 7) // 8)
+    for i, b in enumerate(bits):
+        if b:
+            out[i // 8] |= 0x80 >> (i % 8)
+    return bytes(out), len(bits)
+
+
+def encode_rle(bits):
+    runs = []
+    color, i = 0, 0
+    while i < len(bits):
+        n = 0
+        while i < len(bits) and bits[i] == color:
+            n, i = n + 1, i + 1
+        while n > 270:                  # longest escaped run, then an empty opposite run
+            runs += [270, 0]
+            n -= 270
+        runs.append(n)
+        color ^= 1
+    nibbles = []
+    for r in runs:
+        nibbles += [r] if r < 15 else [15, (r - 15) >> 4, (r - 15) & 15]
+    if len(nibbles) % 2:
+        nibbles.append(0)
+    return bytes(nibbles[k] << 4 | nibbles[k + 1] for k in range(0, len(nibbles), 2)), len(runs)
+
+
+def char_name(c):
+    return repr(chr(c)) if 32 <= c < 127 else "\\x%02X" % c
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("input")
+    ap.add_argument("-o", "--output", help="output C file, default stdout")
+    ap.add_argument("-e", "--encoding", choices=("packed", "rle"), help="force an encoding")
+    ap.add_argument("-v", "--verbose", action="store_true", help="report every glyph")
+    args = ap.parse_args()
+
+    with open(args.input) as f:
+        name, (height, spacing, start, end), descs, bitmap = parse_font(f.read())
+
+    encoded = {}
+    for enc, fn in (("packed", encode_packed), ("rle", encode_rle)):
+        encoded[enc] = [fn(glyph_bits(bitmap, off, w, height)) for w, off in descs]
+    raw_size = len(bitmap)
+    for enc, glyphs in encoded.items():
+        size = sum(len(g) for g, _ in glyphs)
+        cost = [c for _, c in glyphs]
+        sys.stderr.write("%s %s: %d bytes, raw %d (%.1f%%), decode cost per glyph avg %.1f max %d %s\n"
+                         % (name, enc, size, raw_size, 100.0 * size / raw_size,
+                            sum(cost) / len(cost), max(cost), "pixels" if enc == "packed" else "runs"))
+    cache_bytes = max((w + 7) // 8 * height for w, _ in descs)
+    sys.stderr.write("%s: needs SH1106_GLYPH_CACHE_BYTES >= %d%s\n"
+                     % (name, cache_bytes, " (default 64 is too small)" if cache_bytes > 64 else ""))
+    if args.verbose:
+        for i, (w, off) in enumerate(descs):
+            raw = (w + 7) // 8 * height
+            sys.stderr.write("  %-6s w=%-2d raw %3d  packed %3d  rle %3d (%d runs)\n"
+                             % (char_name(start + i), w, raw, len(encoded["packed"][i][0]),
+                                len(encoded["rle"][i][0]), encoded["rle"][i][1]))
+
+    enc = args.encoding or min(encoded, key=lambda e: sum(len(g) for g, _ in encoded[e]))
+    glyphs = encoded[enc]
+    out_name = "%s_%s" % (name, enc)
+    lines = ["/*", " * Generated by tools/sh1106_font.py from %s, %s encoding" % (args.input, enc),
+             " * Needs SH1106_GLYPH_CACHE_BYTES >= %d" % cache_bytes, " */",
+             '#include "fonts.h"', "", "const uint8_t %s_bitmaps[] =" % out_name, "{"]
+    offsets, pos = [], 0
+    for i, (data, _) in enumerate(glyphs):
+        offsets.append(pos)
+        lines.append("    %s /* @%d %s */" % (" ".join("0x%02X," % b for b in data), pos, char_name(start + i)))
+        pos += len(data)
+    if pos > 0xffff:
+        sys.exit("encoded bitmap exceeds 16-bit offsets")
+    lines += ["};", "", "const uint8_t %s_widths[] =" % out_name, "{"]
+    lines += ["    %d, /* %s */" % (w, char_name(start + i)) for i, (w, _) in enumerate(descs)]
+    lines += ["};", "", "const uint16_t %s_offsets[] =" % out_name, "{"]
+    lines += ["    %d," % o for o in offsets]
+    lines += ["};", "", "const font_info_t %s_font_info =" % out_name, "{",
+              "    %d,   /* Character height */" % height,
+              "    %d,   /* C */" % spacing,
+              "    %d,   /* Start character */" % start,
+              "    %d, /* End character */" % end,
+              "    NULL, /* Character descriptors, see widths and offsets */",
+              "    %s_bitmaps,     /* Character bitmap array */" % out_name,
+              "    FONT_ENCODING_%s, /* Bitmap encoding */" % enc.upper(),
+              "    NULL, 0, /* Single range, start to end */",
+              "    %s_widths, %s_offsets, /* Character widths and offsets */" % (out_name, out_name), "};", ""]
+    out = "\n".join(lines)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(out)
+    else:
+        sys.stdout.write(out)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""Convert a 1-bpp image into the sh1106 packed page format.
+
+Input is a PBM file (P1 or P4, e.g. from `convert splash.png splash.pbm`;
+black pixels are lit) or, with --width, a raw page-format image such as the
+blobs passed to mgos_sh1106_update_buffer(). The output is a C array for
+mgos_sh1106_draw_packed() / mgos_sh1106_show_packed(), or the packed bytes
+with --binary. Sizes and the compression ratio are reported on stderr.
+
+See src/sh1106_pack.c for the format.
+"""
+import argparse
+import re
+import sys
+
+MAX_LITERAL = 128
+MAX_FILL = 65
+MAX_COPY = 66
+WINDOW = 256
+
+
+def read_pbm(data):
+    """Return (width, height, rows of 0/1 pixels) of a P1 or P4 file."""
+    pos = 2
+    fields = []
+    magic = data[:2]
+    if magic not in (b"P1", b"P4"):
+        raise ValueError("not a P1/P4 PBM file")
+    while len(fields) < 2:
+        m = re.compile(rb"(?:\s|#[^\n]*\n?)*(\d+)").match(data, pos)
+        if not m:
+            raise ValueError("bad PBM header")
+        fields.append(int(m.group(1)))
+        pos = m.end()
+    width, height = fields
+    if magic == b"P1":
+        bits = [int(c) for c in re.sub(rb"#[^\n]*|\s", b"", data[pos:]).decode()]
+        return width, height, [bits[y * width:(y + 1) * width] for y in range(height)]
+    pos += 1
+    stride = (width + 7) // 8
+    rows = []
+    for y in range(height):
+        row = data[pos + y * stride:pos + (y + 1) * stride]
+        rows.append([(row[x // 8] >> (7 - x % 8)) & 1 for x in range(width)])
+    return width, height, rows
+
+
+def to_pages(width, height, rows):
+    """Page-format bytes, bit 0 is the top row of each page."""
+    pages = (height + 7) // 8
+    out = bytearray(width * pages)
+    for y in range(height):
+        for x in range(width):
+            if rows[y][x]:
+                out[(y // 8) * width + x] |= 1 << (y % 8)
+    return out
+
+
+def pack(data):
+    """Greedy encoder: fills, back references within 256 bytes, literals."""
+    out = bytearray()
+    literal = bytearray()
+
+    def flush():
+        while literal:
+            chunk = literal[:MAX_LITERAL]
+            out.append(len(chunk) - 1)
+            out.extend(chunk)
+            del literal[:MAX_LITERAL]
+
+    i = 0
+    while i < len(data):
+        run = 1
+        while i + run < len(data) and run < MAX_FILL and data[i + run] == data[i]:
+            run += 1
+        best, dist = 0, 0
+        for d in range(1, min(WINDOW, i) + 1):
+            n = 0
+            while i + n < len(data) and n < MAX_COPY and data[i + n] == data[i - d + n]:
+                n += 1
+            if n > best:
+                best, dist = n, d
+        if best >= 3 and best > run:
+            flush()
+            out += bytes((0xc0 | (best - 3), dist - 1))
+            i += best
+        elif run >= 2:
+            flush()
+            out += bytes((0x80 | (run - 2), data[i]))
+            i += run
+        else:
+            literal.append(data[i])
+            i += 1
+    flush()
+    return bytes(out)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("input")
+    ap.add_argument("-o", "--output", help="output file, default stdout")
+    ap.add_argument("-n", "--name", default="image", help="C array name")
+    ap.add_argument("-w", "--width", type=int, help="input is a raw page image this wide")
+    ap.add_argument("-b", "--binary", action="store_true", help="write packed bytes, not C")
+    args = ap.parse_args()
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+    if args.width:
+        width, pages = args.width, len(data) // args.width
+        raw = data[:width * pages]
+    else:
+        width, height, rows = read_pbm(data)
+        pages = (height + 7) // 8
+        raw = to_pages(width, height, rows)
+    if not 0 < width < 65536 or not 0 < pages < 256:
+        sys.exit("image size out of range")
+
+    packed = bytes((ord("P"), width & 0xff, width >> 8, pages)) + pack(raw)
+    sys.stderr.write("%s: %dx%d, %d raw bytes, %d packed (%.1f%%)\n"
+                     % (args.input, width, pages * 8, len(raw), len(packed), 100.0 * len(packed) / len(raw)))
+
+    if args.binary:
+        out = packed
+    else:
+        lines = ["    " + ", ".join("0x%02x" % b for b in packed[i:i + 12]) + ","
+                 for i in range(0, len(packed), 12)]
+        out = ("/* %dx%d packed page image, generated by tools/sh1106_pack.py */\n"
+               "const uint8_t %s[%d] = {\n%s\n};\n"
+               % (width, pages * 8, args.name, len(packed), "\n".join(lines))).encode()
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(out)
+    else:
+        sys.stdout.buffer.write(out)
+
+
+if __name__ == "__main__":
+    main()